@@ -5,6 +5,7 @@
 /*------------- No. Cuenta: 316083298       ---------------*/
 /*------ Chávez Flores Giovanni     		  -------------*/
 /*------------- No. Cuenta: 317053319       ---------------*/
+#define NOMINMAX	//min y max de Windows.h chocan con glm::min/std::min
 #include <Windows.h>
 #include <glad/glad.h>
 #include <glfw3.h>	//main
@@ -26,7 +27,24 @@
 #include <modelAnim.h>
 #include <model.h>
 #include <Skybox.h>
+#include <scene.h>
+#include <assets.h>
+#include <streaming.h>
+#include <timestep.h>
+#include <framepacer.h>
+#include <profiler.h>
+#include <benchmark.h>
+#include <keyframes.h>
+#include <takes.h>
+#include <curves.h>
+#include <statemachine.h>
+#include <entities.h>
+#include <jobs.h>
+#include <lights.h>
+#include <uniforms.h>
 #include <iostream>
+#include <cstring>
+#include <cfloat>
 
 //#pragma comment(lib, "winmm.lib")
 
@@ -56,16 +74,26 @@ movCamera = 0.0f;
 bool First = true;
 
 // timing
-const int FPS = 60;
-const int LOOP_TIME = 1000 / FPS; // = 16 milisec // 1000 millisec == 1 sec
-double	deltaTime = 0.0f,
-		lastFrame = 0.0f;
+const int FPS = 60;	// Pasos de simulacion por segundo
+const double MAX_FPS = 0.0;	// Cuadros dibujados por segundo, 0 sin limite (la tecla G alterna con FPS)
+double	deltaTime = 0.0f;
+FramePacer ritmo(MAX_FPS);
+Profiler perfil;	//La tecla C inicia y termina una captura que se guarda en captura.json
+
+//Modo benchmark (--benchmark [pasos]): ventana oculta, camara con recorrido fijo y un paso de
+//simulacion por cuadro, al terminar imprime los tiempos de cuadro y las llamadas de dibujo
+bool modoBenchmark = false;
+unsigned int pasosBenchmark = 0;	//0 recorre el camino una vez
+const unsigned int BENCH_WIDTH = 1280;
+const unsigned int BENCH_HEIGHT = 720;
+GLFWwindow* ventanaOculta(void);
 
 //Lighting
 glm::vec3 lightPosition(0.0f, 4.0f, -10.0f);
 glm::vec3 lightDirection(0.0f, -1.0f, -1.0f); //Direccion de la fuente de luz
 glm::vec3 myposition02(80.0f, 4.0f, 0.0f);
 glm::vec3 myColor01(0.0f, 0.0f, 1.0f);
+Lights luces;
 
 //-------------------------------------------------------------------------------------
 // Daclaracion de variables que se usaran para las animaciones
@@ -74,49 +102,12 @@ glm::vec3 myColor01(0.0f, 0.0f, 1.0f);
 float luzx = 0.5f, luzy = 0.8f, luzz = 0.8f, noche = 0.0f;
 int dia = 0;
 
-//Sonic
-float posxs = 0.0f,
-poszs = 0.0f,
-posys = 0.0f,
-rotsonic =0.0f,
-incsonic = 0.0f;
-int animsonic = 0;
-
-
-//Rings
-float rotring = 0.0f;
-
 //Freddy
-float rotBrazoF = 0.0f;
-int animFreddy = 0;
 bool Freddyanim = true;
 
 //Chica
-float rotBrazoC = 0.0f, 
-	rotpanque = 0.0f,
-	poszpanque = 18.5f;
-int animChica = 0;
 bool Chicaanim = false;
 
-//eggman
-float eggx = 0.0f,
-	eggy = 0.0f,
-	eggz = 0.0f,
-	rotegg = 0.0f,
-	egginc =0.0f;
-int animegg=0;
-
-//Cheff
-float rotcheff=0.0f,
-	poszsar = 13.5f,
-	rotsarten=0.0f,
-	carnex =0.0f,
-	carney = 0.0f,
-	carnez =0.0f,
-	tempcarne = 0.0f,
-	carneinc =1.5f;
-int animcheff = 0;
-
 //Bunny
 float	rot_bIzqB = 0.0f,
 rot_bDerB = 0.0f,
@@ -156,6 +147,41 @@ bool sube = true;
 //Camara BB
 float BBCameraX = 0.0f, BBCameraZ = 0.0f;
 
+//Escena
+/*Todos los objetos se guardan en una tabla, los indices siguientes apuntan a las 
+entradas que cambian con las animaciones y se actualizan en actualizaEscena()*/
+Scene escena;
+int idSonic = 0,
+	idRing[6],
+	idFreddy = 0,
+	idFreddyBrazo = 0,
+	idEggman = 0,
+	idChica = 0,
+	idChicaBrazo = 0,
+	idPanque = 0,
+	idCheffBD = 0,
+	idCheffBI = 0,
+	idSarten = 0,
+	idCarne = 0,
+	idBunnyBI = 0,
+	idBunnyBD = 0,
+	idBunnyPI = 0,
+	idBunnyPD = 0,
+	idGlobo = 0;
+//Pivotes de BallonBoy
+int idTorsoBB = 0,
+	idCabezaBB = 0,
+	idHombroDerBB = 0,
+	idBrazoDerBB = 0,
+	idHombroIzqBB = 0,
+	idBrazoIzqBB = 0,
+	idPiernaDerBB = 0,
+	idRodDerBB = 0,
+	idPiernaIzqBB = 0,
+	idRodIzqBB = 0,
+	idGloboBB = 0,
+	idLetreroBB = 0;
+
 void movCuerpo() {
 	if (movPierDer <= 40.0f && sube) {
 		movPierDer += 3.0f;
@@ -195,62 +221,354 @@ float posX_globo = 0.0, posy_globo = 20.0, posz_globo = -100;
 float	movGlobo_x = 0.0f, movGlobo_y = 0.0f, movGlobo_z = 0.0f;
 float giroGlobo = 0;
 
-#define MAX_FRAMES 50
-int i_max_steps = 270;
-int i_curr_steps = 9;
+//Cada canal del globo (x, y, z y giro) es una pista de keyframes con sus propios tiempos, la
+//animacion se muestrea en cualquier instante en lugar de sumar incrementos en cada paso
+const float SEGUNDOS_POR_FRAME = 4.5f;	//Tiempo entre keyframes guardados (270 pasos a 60 por segundo)
+KeyframeAnimator animaciones;
+int clipGlobo = animaciones.addClip(4);
+//Los keyframes del globo se leen de este archivo mientras se reproducen, la tecla O guarda ahi los grabados con L
+const char* RUTA_TAKE_GLOBO = "resources/objects/globos/globo.take";
+KeyframeTake takeGlobo;
 
-typedef struct _frame
+void saveFrame(void)
 {
-	//Variables para GUARDAR Key Frames
-	float movGlobo_x;		//Variable para PosicionX
-	float movGlobo_y;		//Variable para PosicionY
-	float movGlobo_z;		//Variable para PosicionZ
-	float movGlobo_xInc;		//Variable para IncrementoX
-	float movGlobo_yInc;		//Variable para IncrementoY
-	float movGlobo_zInc;		//Variable para IncrementoZ
-	float giroGlobo;
-	float giroGloboInc;
-}FRAME; //Estructura Frame
-
-FRAME KeyFrame[MAX_FRAMES];
-int FrameIndex = 46;			//introducir datos
-bool play = false;
-int playIndex = 0;
+	//Para agregar keyframes la animacion pasa del archivo a memoria
+	if (animaciones.source(clipGlobo) != NULL)
+	{
+		takeGlobo.load(animaciones, clipGlobo);
+		animaciones.stream(clipGlobo, NULL);
+		takeGlobo.close();
+	}
+	unsigned int frame = animaciones.keys(clipGlobo, 0);
+	float tiempo = frame * SEGUNDOS_POR_FRAME;
+	animaciones.addKey(clipGlobo, 0, tiempo, movGlobo_x);
+	animaciones.addKey(clipGlobo, 1, tiempo, movGlobo_y);
+	animaciones.addKey(clipGlobo, 2, tiempo, movGlobo_z);
+	animaciones.addKey(clipGlobo, 3, tiempo, giroGlobo);
+	printf("frameindex %u (%.2f s): x %f, y %f, z %f, giroGlobo %f\n", frame, tiempo, movGlobo_x, movGlobo_y, movGlobo_z, giroGlobo);
+}
 
-void saveFrame(void)
+//-----------------------------------------------------------------------
+//Animaciones
+//-------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------
+//Curvas de las animaciones por pasos
+/*Las animaciones de Sonic, Eggman, Chica, el cheff y Freddy son maquinas de estados definidas
+como datos (StateMachineDef): cada estado dice cuanto cambia cada canal por paso, que canales
+siguen un circulo, sus limites y a que estado pasa. Todos los personajes de una maquina avanzan
+juntos en un StateMachinePool. Al inicio cada maquina se ejecuta una vez paso
+por paso y cada paso se guarda en una curva (el primer ciclo como introduccion y el segundo como
+ciclo que se repite), asi el estado en cualquier tiempo se lee directo de la curva sin recorrer
+los pasos anteriores y sin acumular error. Eggman termina dando vueltas sin fin, esa parte se
+calcula con su formula*/
+StateMachineDef maquinaSonic(4);		//posxs, posys, poszs, incsonic
+StateMachineDef maquinaEggman(5);		//eggx, eggy, eggz, rotegg, egginc
+StateMachineDef maquinaChica(3);		//rotBrazoC, poszpanque, rotpanque
+StateMachineDef maquinaCheff(6);		//rotcheff, poszsar, rotsarten, carney, carnez, carneinc
+StateMachineDef maquinaFreddy(1);		//rotBrazoF
+
+BakedCurve curvaSonic(3, FPS);		//posxs, posys, poszs
+BakedCurve curvaEggman(4, FPS);		//eggx, eggy, eggz, rotegg hasta que empieza a dar vueltas
+float vueltasEggman[5];				//Canales de Eggman al empezar a dar vueltas
+BakedCurve curvaChica(3, FPS);		//rotBrazoC, poszpanque, rotpanque
+BakedCurve curvaCheff(5, FPS);		//rotcheff, poszsar, rotsarten, carney, carnez
+BakedCurve curvaFreddy(1, FPS);		//rotBrazoF
+
+void defineMaquinas(void)
 {
-	printf("frameindex %d\n", FrameIndex);
-	KeyFrame[FrameIndex].movGlobo_x = movGlobo_x;
-	printf("KeyFrame[FrameIndex].X = Valor; %d\n", KeyFrame[FrameIndex].movGlobo_x);
-	KeyFrame[FrameIndex].movGlobo_y = movGlobo_y;
-	printf("KeyFrame[FrameIndex].Y = Valor; %d\n", KeyFrame[FrameIndex].movGlobo_y);
-	KeyFrame[FrameIndex].movGlobo_z = movGlobo_z;
-	printf("KeyFrame[FrameIndex].Z = Valor; %d\n", KeyFrame[FrameIndex].movGlobo_z);
-	KeyFrame[FrameIndex].giroGlobo = giroGlobo;
-	printf("KeyFrame[FrameIndex].giroGlobo = Valor; %d\n", KeyFrame[FrameIndex].giroGlobo);
-	FrameIndex++;
+	//Animacion Sonic
+	/*En esta animacion se usa a sonic hecho bolita y tiene que recorrer una parte del mapa, en le 
+	caso 0 sonic avanza al inicio de la rampa, en le caso 1 sonic recorre la rampa circular, en el
+	caso 2 sonic continua el camino restante, despues en los casoso 3,4 y 5realiza de forma 
+	inversa el recorrido*/
+	for (int i = 0; i < 6; i++)
+		maquinaSonic.addState();
+	maquinaSonic.setRate(0, 1, 0.6f);
+	maquinaSonic.addTransition(0, 1, MACHINE_AT_LEAST, 150.0f, 1);
+	//Escala * 3, altura y largo del circulo
+	maquinaSonic.addWave(1, 2, 3, 95.0f, -95.0f, true);
+	maquinaSonic.addWave(1, 1, 3, 150.0f, 95.0f, false);
+	maquinaSonic.setRate(1, 3, 0.01f);
+	maquinaSonic.setRate(1, 0, -0.1f);
+	maquinaSonic.addLimit(1, 0, MACHINE_AT_MOST, -66.0f, -66.0f);
+	maquinaSonic.addTransition(1, 3, MACHINE_AT_LEAST, 6.5f, 2);
+	maquinaSonic.setRate(2, 1, 0.6f);
+	maquinaSonic.addTransition(2, 1, MACHINE_AT_LEAST, 350.0f, 3);
+	maquinaSonic.setRate(3, 1, -0.6f);
+	maquinaSonic.addTransition(3, 1, MACHINE_AT_MOST, 150.0f, 4);
+	maquinaSonic.addWave(4, 2, 3, 95.0f, -95.0f, true);
+	maquinaSonic.addWave(4, 1, 3, 150.0f, 95.0f, false);
+	maquinaSonic.setRate(4, 3, -0.01f);
+	maquinaSonic.setRate(4, 0, 0.1f);
+	maquinaSonic.addTransition(4, 3, MACHINE_AT_MOST, 0.0f, 5, 0.0f);
+	maquinaSonic.setRate(5, 1, -0.6f);
+	maquinaSonic.addTransition(5, 1, MACHINE_AT_MOST, 0.0f, 0, 0.0f);
+
+	//Animacion Eggman
+	/*En este caso se busco darle la animacon de eggman elevandose al cielo, y despues
+	de hacerlo que de vueltas a lo largo del edificio, el caso 1, 2, 3  y 4 se encargan
+	de posiconarlo en el lugar de despegue, en el caso 5 se le da la animacion de 
+	despegue y en el caso 6 se le da la animacion de dar vueltas al edificio*/
+	for (int i = 0; i < 7; i++)
+		maquinaEggman.addState();
+	maquinaEggman.setRate(0, 1, 0.7f);
+	maquinaEggman.addTransition(0, 1, MACHINE_AT_LEAST, 70.0f, 1);
+	maquinaEggman.setRate(1, 3, 0.7f);
+	maquinaEggman.addTransition(1, 3, MACHINE_AT_LEAST, 90.0f, 2);
+	maquinaEggman.setRate(2, 0, 0.7f);
+	maquinaEggman.addTransition(2, 0, MACHINE_AT_LEAST, 200.0f, 3);
+	maquinaEggman.setRate(3, 3, -0.7f);
+	maquinaEggman.addTransition(3, 3, MACHINE_AT_MOST, 0.0f, 4);
+	maquinaEggman.setRate(4, 1, -0.7f);
+	maquinaEggman.addTransition(4, 1, MACHINE_AT_MOST, 40.0f, 5);
+	maquinaEggman.addWave(5, 0, 4, 0.0f, 200.0f, true);
+	maquinaEggman.addWave(5, 1, 4, 0.0f, 200.0f, false);
+	maquinaEggman.setRate(5, 2, 0.9f);
+	maquinaEggman.setRate(5, 4, 0.01f);
+	maquinaEggman.setRate(5, 3, -0.4f);
+	maquinaEggman.addTransition(5, 2, MACHINE_AT_LEAST, 100.0f, 6);
+	maquinaEggman.addWave(6, 0, 4, 0.0f, 200.0f, true);
+	maquinaEggman.addWave(6, 1, 4, 0.0f, 200.0f, false);
+	maquinaEggman.setRate(6, 4, 0.008f);
+	maquinaEggman.setRate(6, 3, -0.46f);
+
+	//Animacio Chica
+	/*En esta animacion se busca que chica lance un panque al aire y que de vueltas
+	a lo largo del recorrido, en el caso 0 el panque y el brazo se mueven al mismo 
+	tiempo, y empieza la rotacion del panque, en le caso 1 el panque se eleva y rota
+	y en el caso 2 	el panque deciende con el brazo de chica mientras termina su 
+	rotacion*/
+	for (int i = 0; i < 3; i++)
+		maquinaChica.addState();
+	maquinaChica.setRate(0, 0, -0.3f);
+	maquinaChica.setRate(0, 1, 0.1f);
+	maquinaChica.setRate(0, 2, 2.7f);
+	maquinaChica.addTransition(0, 0, MACHINE_AT_MOST, -20.0f, 1);
+	maquinaChica.setRate(1, 1, 0.3f);
+	maquinaChica.addTransition(1, 1, MACHINE_AT_LEAST, 25.0f, 2);
+	maquinaChica.setRate(2, 0, 0.3f);
+	maquinaChica.setRate(2, 2, 2.7f);
+	maquinaChica.setRate(2, 1, -0.105f);
+	maquinaChica.addLimit(2, 2, MACHINE_AT_LEAST, 360.0f, 0.0f);
+	maquinaChica.addTransition(2, 0, MACHINE_AT_LEAST, 0.0f, 0);
+
+	//Animacion Cheff
+	/*La animacion consiste en que el cheff lanza el sarten al aire con la carne,
+	y la misma vuela hasta un plato que hay sobre la mesa, en el caso 0 el cheff 
+	lanza el sarten por medio de una rotacion en sus brazos, el sarten aumenta su
+	altura mientras tiene una pequeña rotacion, la carne tambien aumenta su altura
+	mientras realiza un trayectoria curva, en el caso 1 se hace una pequeña pausa
+	en el caso 2 y 3 cambia a otra rotacion y continua la animacion para llegar 
+	al plato, en el caso 4 la carne se da una pequeña pausa a la carn en el 
+	plato antes de repetir la animacion*/
+	for (int i = 0; i < 5; i++)
+		maquinaCheff.addState();
+	maquinaCheff.setRate(0, 0, 0.3f);
+	maquinaCheff.setRate(0, 1, 0.1f);
+	maquinaCheff.setRate(0, 2, 0.25f);
+	maquinaCheff.addWave(0, 4, 5, 0.0f, -15.0f, true);
+	maquinaCheff.addWave(0, 3, 5, 0.0f, 12.0f, false);
+	maquinaCheff.setRate(0, 5, 0.015f);
+	maquinaCheff.addLimit(0, 5, MACHINE_AT_LEAST, 3.0f, 3.0f);
+	maquinaCheff.addTransition(0, 0, MACHINE_AT_LEAST, 30.0f, 1);
+	maquinaCheff.setRate(1, 5, 0.04f);
+	maquinaCheff.addTransition(1, 5, MACHINE_AT_LEAST, 3.1f, 2);
+	maquinaCheff.addWave(2, 4, 5, 0.0f, -15.0f, true);
+	maquinaCheff.addWave(2, 3, 5, 0.0f, 70.0f, false);
+	maquinaCheff.setRate(2, 5, 0.005f);
+	maquinaCheff.setRate(2, 0, -0.3f);
+	maquinaCheff.setRate(2, 2, -0.25f);
+	maquinaCheff.setRate(2, 1, -0.1f);
+	maquinaCheff.addTransition(2, 0, MACHINE_AT_MOST, 0.0f, 3);
+	maquinaCheff.addWave(3, 4, 5, 0.0f, -15.0f, true);
+	maquinaCheff.addWave(3, 3, 5, 0.0f, 70.0f, false);
+	maquinaCheff.setRate(3, 5, 0.008f);
+	maquinaCheff.addTransition(3, 5, MACHINE_AT_LEAST, 4.85f, 4);
+	maquinaCheff.setRate(4, 5, 0.01f);
+	maquinaCheff.addTransition(4, 5, MACHINE_AT_LEAST, 7.0f, 0, 1.5f);
+
+	//Animacion Saludo Freddy
+	/*Se busca darle una animacion de saludo, para ello se le da animacion al brazo realiando 
+	rotaciones en el brazo, en el caso 0 el brazo sube por medioD de una rotacion y en el 
+	caso 1 el brazo deciende por emdio de otra rotacion*/
+	maquinaFreddy.addState();
+	maquinaFreddy.addState();
+	maquinaFreddy.setRate(0, 0, 1.0f);
+	maquinaFreddy.addTransition(0, 0, MACHINE_AT_LEAST, 45.0f, 1);
+	maquinaFreddy.setRate(1, 0, -1.0f);
+	maquinaFreddy.addTransition(1, 0, MACHINE_AT_MOST, -45.0f, 0);
 }
 
-//Punto de incio para reproducir
-void resetElements(void)
+//Guarda dos ciclos de una maquina en su curva, un ciclo termina cuando la maquina sale del estado 0 y regresa a el
+void horneaCiclos(const StateMachineDef &maquina, const float *inicial, BakedCurve &curva)
 {
-	movGlobo_x = KeyFrame[0].movGlobo_x;
-	movGlobo_y = KeyFrame[0].movGlobo_y;
-	movGlobo_y = KeyFrame[0].movGlobo_z;
-	giroGlobo = KeyFrame[0].giroGlobo;
+	StateMachinePool pool(maquina);
+	int actor = pool.spawn(inicial);
+	std::vector<float> valores(curva.channels());
+	for (int ciclo = 0; ciclo < 2; ciclo++)
+	{
+		if (ciclo == 1)
+			curva.beginLoop();
+		bool salio = false;
+		while (!salio || pool.state(actor) != 0) {
+			for (unsigned int c = 0; c < curva.channels(); c++)
+				valores[c] = pool.value(actor, c);
+			curva.add(&valores[0]);
+			pool.step();
+			salio = salio || pool.state(actor) != 0;
+		}
+	}
 }
 
-void interpolation(void)
+void horneaAnimaciones(void)
 {
-	KeyFrame[playIndex].movGlobo_xInc = (KeyFrame[playIndex + 1].movGlobo_x - KeyFrame[playIndex].movGlobo_x) / i_max_steps;
-	KeyFrame[playIndex].movGlobo_yInc = (KeyFrame[playIndex + 1].movGlobo_y - KeyFrame[playIndex].movGlobo_y) / i_max_steps;
-	KeyFrame[playIndex].movGlobo_zInc = (KeyFrame[playIndex + 1].movGlobo_z - KeyFrame[playIndex].movGlobo_z) / i_max_steps;
-	KeyFrame[playIndex].giroGloboInc = (KeyFrame[playIndex + 1].giroGlobo - KeyFrame[playIndex].giroGlobo) / i_max_steps;
+	const float sonic[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	horneaCiclos(maquinaSonic, sonic, curvaSonic);
+
+	const float eggman[5] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	StateMachinePool pool(maquinaEggman);
+	int actor = pool.spawn(eggman);
+	curvaEggman.setAngle(3);
+	for (;;) {
+		float valores[4] = { pool.value(actor, 0), pool.value(actor, 1), pool.value(actor, 2), pool.value(actor, 3) };
+		curvaEggman.add(valores);
+		if (pool.state(actor) == 6)
+			break;
+		pool.step();
+	}
+	for (int c = 0; c < 5; c++)
+		vueltasEggman[c] = pool.value(actor, c);
+
+	const float chica[3] = { 0.0f, 18.5f, 0.0f };
+	curvaChica.setAngle(2);
+	horneaCiclos(maquinaChica, chica, curvaChica);
+
+	const float cheff[6] = { 0.0f, 13.5f, 0.0f, 0.0f, 0.0f, 1.5f };
+	horneaCiclos(maquinaCheff, cheff, curvaCheff);
+
+	const float freddy[1] = { 0.0f };
+	horneaCiclos(maquinaFreddy, freddy, curvaFreddy);
 }
 
 //-----------------------------------------------------------------------
-//Animaciones
+//Personajes
 //-------------------------------------------------------------------
+/*Los objetos animados son entidades del mundo con sus componentes (posicion, giro, orbita y la
+curva que reproducen), asi cada personaje se puede copiar las veces que se quiera*/
+World mundo(FPS);
+/*Trabajos de cada cuadro (sistemas del mundo, matrices, culling y listas de dibujo) repartidos
+entre todos los nucleos; solo las llamadas a OpenGL quedan en el hilo principal*/
+JobSystem trabajos;
+std::vector<Entity> personajeSonic, personajeFreddy, personajeChica;	//Piezas de cada personaje para copiarlo
+int copiasSonic = 0, copiasFreddy = 0, copiasChica = 0;
+
+//Reproductor de una curva desde su inicio, los canales se enlazan con enlaza()
+KeyframePlayer reproductor(const BakedCurve &curva, const glm::vec3 &origen)
+{
+	KeyframePlayer p = {};
+	p.curve = &curva;
+	p.playing = true;
+	p.origin = origen;
+	return p;
+}
+
+void enlaza(KeyframePlayer &p, unsigned int canal, KeyframeTarget destino, float ganancia = 1.0f)
+{
+	KeyframeBinding enlace = { canal, destino, ganancia };
+	p.bindings[p.bindingCount++] = enlace;
+}
+
+//Giro sobre eje entre dos rotaciones fijas, con porPaso el angulo avanza solo con el reloj del mundo
+Spin giro(const glm::vec3 &eje, const glm::quat &antes, const glm::quat &despues, double porPaso = 0.0, float vuelta = 0.0f)
+{
+	Spin s = { antes, eje, despues, 0.0f, 0.0, porPaso, vuelta, 0 };
+	return s;
+}
+
+void creaPersonajes(void)
+{
+	const glm::vec3 ejeX(1.0f, 0.0f, 0.0f), ejeY(0.0f, 1.0f, 0.0f), ejeZ(0.0f, 0.0f, 1.0f);
+	const glm::quat sinGiro(1.0f, 0.0f, 0.0f, 0.0f);
+
+	//Sonic recorre su curva y gira 1.5 grados por paso para simular que va rodando
+	Entity sonic = mundo.create(escena, idSonic);
+	KeyframePlayer recorridoSonic = reproductor(curvaSonic, glm::vec3(340.0f, 11.0f, 0.0f));
+	enlaza(recorridoSonic, 0, KEYFRAME_X);
+	enlaza(recorridoSonic, 2, KEYFRAME_Y);
+	enlaza(recorridoSonic, 1, KEYFRAME_Z);
+	mundo.players.add(sonic, recorridoSonic);
+	mundo.spins.add(sonic, giro(ejeX, sinGiro, sinGiro, 1.5, 360.0f));
+	personajeSonic.push_back(sonic);
+
+	//Rings
+	for (int i = 0; i < 6; i++)
+		mundo.spins.add(mundo.create(escena, idRing[i]), giro(ejeY, sinGiro, sinGiro, 2.5, 180.0f));
+
+	//Freddy saluda con el brazo
+	Entity brazoFreddy = mundo.create(escena, idFreddyBrazo);
+	KeyframePlayer saludo = reproductor(curvaFreddy, glm::vec3(0.0f));
+	enlaza(saludo, 0, KEYFRAME_SPIN);
+	mundo.players.add(brazoFreddy, saludo);
+	mundo.spins.add(brazoFreddy, giro(ejeZ, sinGiro, sinGiro));
+	personajeFreddy.push_back(mundo.create(escena, idFreddy));
+	personajeFreddy.push_back(brazoFreddy);
+
+	//Eggman despega siguiendo su curva y despues da vueltas al edificio
+	Entity eggman = mundo.create(escena, idEggman);
+	KeyframePlayer despegue = reproductor(curvaEggman, glm::vec3(0.0f));
+	enlaza(despegue, 0, KEYFRAME_X);
+	enlaza(despegue, 2, KEYFRAME_Y);
+	enlaza(despegue, 1, KEYFRAME_Z);
+	enlaza(despegue, 3, KEYFRAME_SPIN);
+	mundo.players.add(eggman, despegue);
+	//Las vueltas empiezan en la ultima muestra del despegue, el primer paso todavia usa el incremento del despegue
+	unsigned long long inicioVueltas = curvaEggman.samples() - 1;
+	Orbit vueltas = { glm::vec3(0.0f, vueltasEggman[2], 0.0f), 200.0f, vueltasEggman[4] - 0.008, 0.008, inicioVueltas };
+	mundo.orbits.add(eggman, vueltas);
+	Spin giroEggman = giro(ejeY, sinGiro, sinGiro, -0.46, 360.0f);
+	giroEggman.phase = vueltasEggman[3];
+	giroEggman.start = inicioVueltas;
+	mundo.spins.add(eggman, giroEggman);
+
+	//Chica lanza el panque
+	Entity brazoChica = mundo.create(escena, idChicaBrazo);
+	KeyframePlayer lanzamiento = reproductor(curvaChica, glm::vec3(0.0f));
+	enlaza(lanzamiento, 0, KEYFRAME_SPIN);
+	mundo.players.add(brazoChica, lanzamiento);
+	mundo.spins.add(brazoChica, giro(ejeX, sinGiro, sinGiro));
+	Entity panque = mundo.create(escena, idPanque);
+	KeyframePlayer vuelo = reproductor(curvaChica, glm::vec3(-4.5f, 0.0f, -212.0f));
+	enlaza(vuelo, 1, KEYFRAME_Y);
+	enlaza(vuelo, 2, KEYFRAME_SPIN);
+	mundo.players.add(panque, vuelo);
+	mundo.spins.add(panque, giro(ejeX, sinGiro, sinGiro));
+	personajeChica.push_back(mundo.create(escena, idChica));
+	personajeChica.push_back(brazoChica);
+	personajeChica.push_back(panque);
+
+	//El cheff lanza el sarten y la carne vuela al plato
+	Entity brazoDer = mundo.create(escena, idCheffBD);
+	KeyframePlayer brazos = reproductor(curvaCheff, glm::vec3(0.0f));
+	enlaza(brazos, 0, KEYFRAME_SPIN);
+	mundo.players.add(brazoDer, brazos);
+	mundo.spins.add(brazoDer, giro(ejeZ, sinGiro, axisAngle(105.0f, ejeY) * axisAngle(-90.0f, ejeX)));
+	Entity brazoIzq = mundo.create(escena, idCheffBI);
+	brazos.bindings[0].gain = -1.0f;
+	mundo.players.add(brazoIzq, brazos);
+	mundo.spins.add(brazoIzq, giro(ejeZ, sinGiro, axisAngle(75.0f, ejeY) * axisAngle(-90.0f, ejeX)));
+	Entity sarten = mundo.create(escena, idSarten);
+	KeyframePlayer vueloSarten = reproductor(curvaCheff, glm::vec3(-180.0f, 0.0f, 7.0f));
+	enlaza(vueloSarten, 1, KEYFRAME_Y);
+	enlaza(vueloSarten, 2, KEYFRAME_SPIN);
+	mundo.players.add(sarten, vueloSarten);
+	mundo.spins.add(sarten, giro(ejeZ, axisAngle(-90.0f, ejeY), sinGiro));
+	Entity carne = mundo.create(escena, idCarne);
+	KeyframePlayer vueloCarne = reproductor(curvaCheff, glm::vec3(-180.0f, 13.5f, 0.0f));
+	enlaza(vueloCarne, 4, KEYFRAME_Y);
+	enlaza(vueloCarne, 3, KEYFRAME_Z);
+	mundo.players.add(carne, vueloCarne);
+}
 
 void animate(void)
 {
@@ -283,264 +601,108 @@ void animate(void)
 	}
 	//--------------------------------------------------------------------------------
 	//Animacion por keyframes
-	if (play)
+	bool globoActivo = animaciones.playing(clipGlobo);
+	animaciones.advance(1.0f / FPS);
+	animaciones.evaluate();
+	if (globoActivo)
 	{
-		if (i_curr_steps >= i_max_steps) //end of animation between frames?
-		{
-			playIndex++;
-			printf("Frame [%d] reproducido \n", playIndex - 1);
-			if (playIndex > FrameIndex - 2)	//end of total animation?
-			{
-				printf("Ultimo frame es [%d] \n", FrameIndex - 1);
-				//fprintf(guardarFrames,"FrameIndex [%d]" ,FrameIndex);
-				printf("Termina animaci�n\n");
-				playIndex = 0;
-				play = false;
-			}
-			else //Next frame interpolations
-			{
-				//printf("entro aqu�\n");
-				i_curr_steps = 0; //Reset counter
-				//Interpolation
-				interpolation();
-			}
-		}
-		else
-		{
-			movGlobo_x += KeyFrame[playIndex].movGlobo_xInc;
-			movGlobo_y += KeyFrame[playIndex].movGlobo_yInc;
-			movGlobo_z += KeyFrame[playIndex].movGlobo_zInc;
-			giroGlobo += KeyFrame[playIndex].giroGloboInc;
-			i_curr_steps++;
-		}
+		movGlobo_x = animaciones.value(clipGlobo, 0);
+		movGlobo_y = animaciones.value(clipGlobo, 1);
+		movGlobo_z = animaciones.value(clipGlobo, 2);
+		giroGlobo = animaciones.value(clipGlobo, 3);
+		if (!animaciones.playing(clipGlobo))
+			printf("Termina animacion\n");
 	}
 	//--------------------------------------------------------------------------------
-	//Animacion Sonic
-	/*En esta animacion se usa a sonic hecho bolita y tiene que recorrer una parte del mapa, en le 
-	caso 0 sonic avanza al inicio de la rampa, en le caso 1 sonic recorre la rampa circular, en el
-	caso 2 sonic continua el camino restante, despues en los casoso 3,4 y 5realiza de forma 
-	inversa el recorrido, tambien se le dio una rotacion, para simular que esta girando mientras avanaza*/
-	rotsonic += 1.5f;
-	switch (animsonic) {
-	case 0:
-		posys += 0.6f;
-			if(posys >= 150)
-				animsonic = 1;
-		break;
-	case 1:
-		//Escala * 3 
-		poszs = 95 + ( -95 *cos(incsonic));//altura circ 
-		posys =  150 + ( 95 *sin(incsonic));//largo circ 
-		incsonic += 0.01;
-
-		posxs -= 0.1;
-		if (incsonic >= 6.5) { //3
-			animsonic = 2;
-		}
-		if (posxs <= -66) {
-			posxs = -66.0f;
-		}
-		break;
-	case 2:
-		posys += 0.6f;
-		if (posys >= 350)
-			animsonic = 3;
-		break;
-
-	case 3:
-		posys -= 0.6f;
-		if (posys <= 150)
-			animsonic = 4;
-		break;
-	case 4:
-		poszs = 95 + (-95 * cos(incsonic));//altura circ 
-		posys = 150 + (95 * sin(incsonic));//largo circ 
-		incsonic -= 0.01;
-
-		posxs += 0.1;
-		if (incsonic <= 0.0) { 
-			incsonic = 0.0f;	//1.5
-			animsonic = 5;
-		}
-		break;
-	case 5:
-		posys -= 0.6f;
-		if (posys <= 0) {
-			posys = 0;
-			animsonic = 0;
-		}
-			
-		break;
+	//Personajes
+	/*Sonic, los rings, Freddy, Eggman, Chica, el cheff y sus copias avanzan juntos (ver
+	creaPersonajes). Freddy y Chica solo avanzan mientras su animacion esta activa*/
+	for (unsigned int i = 0; i < mundo.players.size(); i++)
+	{
+		KeyframePlayer &p = mundo.players.data[i];
+		if (p.curve == &curvaFreddy)
+			p.playing = Freddyanim;
+		else if (p.curve == &curvaChica)
+			p.playing = Chicaanim;
 	}
-	//--------------------------------------------------------------------------------
-	//Animacion Ring
-	/*Esta animacion se le da giro al ring*/
-	rotring += 2.5;
-	if (rotring >= 180)
-		rotring = 0.0f;
-	//--------------------------------------------------------------------------------
-	//Animacion Saludo Freddy
-	/*Se busca darle una animacion de saludo, para ello se le da animacion al brazo realiando 
-	rotaciones en el brazo, en el caso 0 el brazo sube por medioD de una rotacion y en el 
-	caso 1 el brazo deciende por emdio de otra rotacion*/
-	if (Freddyanim) {
-		switch (animFreddy) {
-		case 0:
-			rotBrazoF += 1.0f;
-			if (rotBrazoF >= 45)
-				animFreddy = 1;
-			break;
-		case 1:
+	mundo.update(escena, trabajos);
+	trabajos.run();
 
-			rotBrazoF -= 1.0f;
-			if (rotBrazoF <= -45)
-				animFreddy = 0;
-			break;
-		}
-	}
-	//--------------------------------------------------------------------------------
-	//Animacion Eggman
-	/*En este caso se busco darle la animacon de eggman elevandose al cielo, y despues
-	de hacerlo que de vueltas a lo largo del edificio, el caso 1, 2, 3  y 4 se encargan
-	de posiconarlo en el lugar de despegue, en el caso 5 se le da la animacion de 
-	despegue y en el caso 6 se le da la animacion de dar vueltas al edificio*/
-	switch (animegg) {
-		case 0:
-			eggy += 0.7f;
-			if (eggy >= 70)
-				animegg = 1;
-			break;
-		case 1:
-			rotegg += 0.7f;
+}
 
-			if (rotegg >= 90)
-				animegg = 2;
-			break;
-		case 2:
-			eggx += 0.7f;
-			if (eggx >= 200)
-				animegg = 3;
-		break;
-		case 3:
-			rotegg -= 0.7f;
-
-			if (rotegg <= 0)
-				animegg = 4;
-			break;
-		case 4:
-			eggy -= 0.7f;
-			if (eggy <= 40)
-				animegg = 5;
-			break;
-		case 5:
-			eggz += 0.3f;
-			eggx = 200 * cos(egginc);
-			eggz += 0.3f;
-			eggy = 200 * sin(egginc);
-			eggz += 0.3f;
-			egginc += 0.01f;
-			rotegg -= 0.4f;
-			if (eggz >= 100)
-				animegg = 6;
-			break;
-		case 6:
-			rotegg -= 0.46f;
-			eggx = 200 * cos(egginc);
-			eggy = 200 * sin(egginc);
-			egginc += 0.008f;
-			break;
-	}
-	//--------------------------------------------------------------------------------
-	//Animacio Chica
-	/*En esta animacion se busca que chica lance un panque al aire y que de vueltas
-	a lo largo del recorrido, en el caso 0 el panque y el brazo se mueven al mismo 
-	tiempo, y empieza la rotacion del panque, en le caso 1 el panque se eleva y rota
-	y en el caso 2 	el panque deciende con el brazo de chica mientras termina su 
-	rotacion*/
-	if (Chicaanim) {
-		switch (animChica) {
-		case 0:
-			rotBrazoC -= 0.3f;
-			poszpanque += 0.1f;
-			rotpanque += 2.7;
-			if (rotBrazoC <= -20)
-				animChica = 1;
-			break;
-		case 1:
-			poszpanque += 0.3f;
-			if (poszpanque >= 25)
-				animChica = 2;
-			break;
-		case 2:
-			rotBrazoC += 0.3f;
-			rotpanque += 2.7;
-			poszpanque -= 0.105f;
-			if (rotpanque >= 360)
-				rotpanque = 0;
-			if (rotBrazoC >= 0)
-				animChica = 0;
-			break;
-		}
-	}
-	//--------------------------------------------------------------------------------
-	//Animacion Cheff
-	/*La animacion consiste en que el cheff lanza el sarten al aire con la carne,
-	y la misma vuela hasta un plato que hay sobre la mesa, en el caso 0 el cheff 
-	lanza el sarten por medio de una rotacion en sus brazos, el sarten aumenta su
-	altura mientras tiene una pequeña rotacion, la carne tambien aumenta su altura
-	mientras realiza un trayectoria curva, en el caso 1 se hace una pequeña pausa
-	en el caso 2 y 3 cambia a otra rotacion y continua la animacion para llegar 
-	al plato, en el caso 4 la carne se da una pequeña pausa a la carn en el 
-	plato antes de repetir la animacion*/
-	switch(animcheff){
-	case 0:
-		rotcheff += 0.3f;
-		poszsar += 0.1;
-		rotsarten += 0.25;
-		carnez = -15.0 * cos(carneinc);
-		carney = 12.0 * sin(carneinc);
-		carneinc += 0.015;
-		if (carneinc >= 3) { //3
-			carneinc = 3.0f;	//1.5
-		}
-		if (rotcheff >= 30)
-			animcheff = 1;
-		break;
-	case 1:
-		carneinc += 0.04;
-		if (carneinc >= 3.1) {
-			animcheff = 2;
-		}
-		break;
-	case 2:
-		carnez = -15.0 * cos(carneinc);
-		carney = 70 * sin(carneinc);
-		carneinc += 0.005;
-		rotcheff -= 0.3f;
-		rotsarten -= 0.25;
-		poszsar -= 0.1;
-
-		if (rotcheff <= 0) {
-			animcheff = 3;
-		}		
-		break;
-	case 3:
-		carnez = -15.0 * cos(carneinc);
-		carney = 70 * sin(carneinc);
-		carneinc += 0.008;
-		if (carneinc >= 4.85) {
-			animcheff = 4;
-		}
-		break;
-	case 4:
-		carneinc += 0.01;
-		if (carneinc >= 7) {
-			carneinc = 1.5f;
-			animcheff = 0;
-		}
-		break;
-	}
+//-----------------------------------------------------------------------
+//Copia los valores de las animaciones a la tabla de la escena
+//-------------------------------------------------------------------
+void actualizaEscena(void)
+{
+	const glm::vec3 ejeX(1.0f, 0.0f, 0.0f), ejeY(0.0f, 1.0f, 0.0f), ejeZ(0.0f, 0.0f, 1.0f);
+
+	//Personajes del mundo
+	mundo.sync(escena);
+
+	//Bunny
+	escena.setRotation(idBunnyBI, axisAngle(rot_bIzqB, ejeX));
+	escena.setRotation(idBunnyBD, axisAngle(rot_bDerB, ejeX));
+	escena.setRotation(idBunnyPI, axisAngle(rot_pIzqB, ejeX));
+	escena.setRotation(idBunnyPD, axisAngle(rot_pDerB, ejeX));
 
+	//Globo
+	escena.setPosition(idGlobo, glm::vec3(posX_globo + movGlobo_x, posy_globo + movGlobo_y, posz_globo));
+	escena.setRotation(idGlobo, axisAngle(-90.0f, ejeY) * axisAngle(giroGlobo, ejeY));
+
+	//BallonBoy
+	escena.setRotation(idCabezaBB, axisAngle(movCabeza, ejeY));
+	escena.setRotation(idHombroDerBB, axisAngle(movHombroDer, ejeZ));
+	escena.setRotation(idBrazoDerBB, axisAngle(movBrazoDer, ejeZ));
+	escena.setRotation(idHombroIzqBB, axisAngle(-movHombroIzq, ejeZ));
+	escena.setRotation(idBrazoIzqBB, axisAngle(-movBrazIzq, ejeZ));
+	escena.setRotation(idPiernaDerBB, axisAngle(movPierDer, ejeX));
+	escena.setRotation(idRodDerBB, axisAngle(rotRodDer, ejeX));
+	escena.setRotation(idPiernaIzqBB, axisAngle(movPierIzq, ejeX));
+	escena.setRotation(idRodIzqBB, axisAngle(rotRodIzq, ejeX));
+	escena.setRotation(idGloboBB, axisAngle(-movBrazIzq, ejeZ));
+	escena.setRotation(idLetreroBB, axisAngle(movBrazoDer, ejeZ));
+}
+
+//-----------------------------------------------------------------------
+//BallonBoy sigue a la camara, se coloca en cada cuadro y no se interpola
+//-------------------------------------------------------------------
+void sigueCamara(void)
+{
+	const glm::vec3 ejeY(0.0f, 1.0f, 0.0f);
+
+	BBCameraX = 1.75f * glm::cos(glm::radians(camera.getYaw()));
+	BBCameraZ = 1.5f * glm::sin(glm::radians(camera.getYaw()));
+	escena.setPosition(idTorsoBB, glm::vec3(camera.getPosition().x + BBCameraX, camera.getPosition().y, camera.getPosition().z) + BBCameraZ);
+	escena.setRotation(idTorsoBB, axisAngle(-camera.getYaw() + 90.0f, ejeY));
+	escena.snap(idTorsoBB);
+}
+
+//-----------------------------------------------------------------------
+//Iluminacion
+/*Las luces puntuales no cambian y se configuran una sola vez en main(), aqui solo
+se actualizan la luz direccional del ciclo de dia y noche y el reflector de la camara.
+Lights solo envia a los shaders las luces que cambiaron*/
+//-------------------------------------------------------------------
+void configuraLuces(void)
+{
+	luces.setDirLight(lightDirection,
+		glm::vec3(luzx, luzy, luzz),	//Da luz a todo
+		glm::vec3(0.0f, 0.0f, 0.0f),	//Da luz desde un punto
+		glm::vec3(0.0f, 0.0f, 0.0f));	//Brillo sobre una superficie
+
+	//fuente de luz reflector
+	luces.setSpotLight(0,
+		camera.Position,	//Posicion
+		camera.Front,		//Direccion a donde apunta la luz
+		glm::vec3(0.3f, 0.3f, 0.3f),
+		glm::vec3(1.0f, 1.0f, 1.0f),
+		glm::vec3(0.0f, 0.0f, 0.0f),
+		glm::cos(glm::radians(10.0f)),	//Maxima iluminacion
+		glm::cos(glm::radians(20.0f)),	//Disminucion de la intensidad
+		0.5f,
+		0.0009f,	//Distancia que viajara la luz
+		0.005f);
 }
 
 void getResolution()
@@ -552,8 +714,42 @@ void getResolution()
 }
 
 
-int main()
+//Ventana sin mostrar para el benchmark. Sin pantalla (un servidor sin GPU) usa la plataforma nula de
+//GLFW 3.4 con un contexto OSMesa que dibuja en el CPU
+GLFWwindow* ventanaOculta()
 {
+	SCR_WIDTH = BENCH_WIDTH;
+	SCR_HEIGHT = BENCH_HEIGHT;
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* ventana = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "CGeIHC benchmark", NULL, NULL);
+#if defined(GLFW_PLATFORM_NULL) && defined(GLFW_OSMESA_CONTEXT_API)
+	if (ventana == NULL)
+	{
+		glfwTerminate();
+		glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+		if (glfwInit())
+		{
+			glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+			ventana = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "CGeIHC benchmark", NULL, NULL);
+		}
+	}
+#endif
+	return ventana;
+}
+
+
+int main(int argc, char** argv)
+{
+	for (int a = 1; a < argc; a++)
+	{
+		if (std::strcmp(argv[a], "--benchmark") == 0)
+		{
+			modoBenchmark = true;
+			if (a + 1 < argc && argv[a + 1][0] >= '0' && argv[a + 1][0] <= '9')
+				pasosBenchmark = (unsigned int)atoi(argv[++a]);
+		}
+	}
+
 	// glfw: initialize and configure
 	// ------------------------------
 	glfwInit();
@@ -566,10 +762,15 @@ int main()
 	// glfw window creation
 	// --------------------
 	
-	monitors = glfwGetPrimaryMonitor();
-	getResolution();
-
-	GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "CGeIHC", NULL, NULL);
+	GLFWwindow* window = NULL;
+	if (modoBenchmark)
+		window = ventanaOculta();
+	else
+	{
+		monitors = glfwGetPrimaryMonitor();
+		getResolution();
+		window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "CGeIHC", NULL, NULL);
+	}
 	if (window == NULL)
 	{
 		std::cout << "Failed to create GLFW window" << std::endl;
@@ -582,6 +783,8 @@ int main()
 	glfwSetCursorPosCallback(window, mouse_callback);
 	glfwSetScrollCallback(window, scroll_callback);
 	glfwSetKeyCallback(window, my_input);
+	//Sin sincronia vertical, las animaciones no dependen de los cuadros por segundo
+	glfwSwapInterval(0);
 
 	// tell GLFW to capture our mouse
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
@@ -596,15 +799,18 @@ int main()
 	//-------------------------------------------------------------------------
 	//Sonido de fondo
 	//---------------------------------------------------------------------
-	irrklang::ISoundEngine* engine = irrklang::createIrrKlangDevice();
-	
-	if (!engine) {
-		printf("Could not startup engine ");
-		return 0; //eror inciando engine
-	}
+	//El benchmark corre sin sonido
+	if (!modoBenchmark) {
+		irrklang::ISoundEngine* engine = irrklang::createIrrKlangDevice();
+
+		if (!engine) {
+			printf("Could not startup engine ");
+			return 0; //eror inciando engine
+		}
 
-	engine->play2D("fnaf.mp3", true);
-	engine->setSoundVolume(0.4f);
+		engine->play2D("fnaf.mp3", true);
+		engine->setSoundVolume(0.4f);
+	}
 	//--------------------------------
 	// configure global opengl state
 	// ------------------------------
@@ -617,6 +823,13 @@ int main()
 	Shader staticShader("Shaders/shader_Lights.vs", "Shaders/shader_Lights_mod.fs");
 	Shader skyboxShader("Shaders/skybox.vs", "Shaders/skybox.fs");
 	Shader animShader("Shaders/anim.vs", "Shaders/anim.fs");
+	Shader instShader("Shaders/shader_Lights_inst.vs", "Shaders/shader_Lights_mod.fs");	//Objetos repetidos con instancing
+
+	//Las ubicaciones de los uniforms se resuelven una sola vez por programa
+	UniformCache staticUniforms(staticShader);
+	UniformCache skyboxUniforms(skyboxShader);
+	UniformCache animUniforms(animShader);
+	UniformCache instUniforms(instShader);
 
 	vector<std::string> faces
 	{
@@ -628,337 +841,336 @@ int main()
 		"resources/skybox/backcity.jpg" 
 	};
 
-	Skybox skybox = Skybox(faces);
-
 	// Shader configuration
 	// --------------------
 	skyboxShader.use();
-	skyboxShader.setInt("skybox", 0);
+	skyboxUniforms.setInt(Uniform::skybox, 0);
+
+	//Luces puntuales fijas, el resto se actualiza en configuraLuces()
+	luces.setup();
+	luces.setPointLight(0, lightPosition,
+		glm::vec3(0.2f, 0.2f, 0.2f),
+		glm::vec3(1.0f, 1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 0.0f),
+		0.008f,		//Potencia de la luz
+		0.009f,		//distancia de luz, control mas fino
+		0.032f);	//distancia de luz, es mas brusco, a mas pequeño menor atenuacion mas viaja la luz
+	luces.setPointLight(1, glm::vec3(-80.0, 0.0f, 0.0f),
+		glm::vec3(0.0f, 0.2f, 0.0f),
+		myColor01,
+		glm::vec3(0.0f, 0.0f, 0.0f),
+		1.0f,
+		0.009f,
+		0.00000032f);
+	luces.setPointLight(2, myposition02,
+		glm::vec3(0.0f, 0.2f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f),
+		glm::vec3(0.0f, 0.0f, 0.0f),
+		1.0f,
+		0.009f,
+		0.0000032f);
+
+	staticShader.use();
+	staticUniforms.setFloat(Uniform::materialShininess, 32.0f);
+	instShader.use();
+	instUniforms.setFloat(Uniform::materialShininess, 32.0f);
 
 	// load models
 	// -----------
-	Model piso("resources/objects/piso/piso.obj");
+	//Los modelos se leen y decodifican en hilos de trabajo, las subidas a GPU ocurren en este hilo.
+	//Un archivo pedido dos veces (piernaDerAb.obj) regresa el mismo modelo
+	AssetLoader cargador;
+	//Las regiones lejanas (el diorama de Sonic) solo se cargan cuando la camara se acerca y se
+	//descargan cuando se aleja, sus modelos no dibujan nada mientras tanto
+	RegionStreamer regiones(cargador);
+	int regionSonic = regiones.addRegion(glm::vec3(220.0f, -15.0f, -30.0f), glm::vec3(400.0f, 200.0f, 300.0f));
+	//Eggman vuela en circulo sobre todo el mapa, su region cubre su recorrido
+	int regionEggman = regiones.addRegion(glm::vec3(-210.0f, -15.0f, -210.0f), glm::vec3(210.0f, 120.0f, 210.0f));
+	//En el benchmark todas las regiones se cargan al inicio para medir solo el dibujo
+	if (modoBenchmark)
+	{
+		regiones.loadDistance = FLT_MAX;
+		regiones.unloadDistance = FLT_MAX;
+	}
+	StaticModel &piso = cargador.model("resources/objects/piso/piso.obj");
 	
 	//--------------------------------------------------------------------------------
 	//Modelos Proyecto
 	//-------------------------------------------------------------------------------
 	//Elementos sin animacion
 	//--------------------------------------------------------------------------------
-	Model restaurante("resources/objects/restaurante/rest.obj");
-	Model mesa("resources/objects/mesa/mesa.obj");
-	Model silla("resources/objects/silla/silla.obj");
-	Model pastel("resources/objects/pastel/pastel.obj");
-	Model micro("resources/objects/microfono/micro.obj");
-	Model globor("resources/objects/globos/globor.obj");
-	Model globop("resources/objects/globos/globop.obj");
-	Model globon("resources/objects/globos/globon.obj");
-	Model globodec("resources/objects/globos/globodec.obj");
-	Model cocina("resources/objects/cocina/cocina.obj");
-	Model bar("resources/objects/bar/bar.obj");
-	Model cortina("resources/objects/cortina/cortina.obj");
-	Model Arcade1("resources/objects/arcade/a1.obj");
-	Model Arcade2("resources/objects/arcade/a2.obj");
-	Model Arcade3("resources/objects/arcade/a3.obj");
+	StaticModel &restaurante = cargador.model("resources/objects/restaurante/rest.obj");
+	StaticModel &mesa = cargador.model("resources/objects/mesa/mesa.obj");
+	StaticModel &pastel = cargador.model("resources/objects/pastel/pastel.obj");
+	StaticModel &micro = cargador.model("resources/objects/microfono/micro.obj");
+	StaticModel &cocina = cargador.model("resources/objects/cocina/cocina.obj");
+	StaticModel &bar = cargador.model("resources/objects/bar/bar.obj");
+	StaticModel &cortina = cargador.model("resources/objects/cortina/cortina.obj");
+	StaticModel &Arcade1 = cargador.model("resources/objects/arcade/a1.obj");
+	StaticModel &Arcade2 = cargador.model("resources/objects/arcade/a2.obj");
+	StaticModel &Arcade3 = cargador.model("resources/objects/arcade/a3.obj");
 	//--------------------------------------------------------------------------------
 	//Modelos con animacion
 	//--------------------------------------------------------------------------------
 	//Sonic
-	Model mapa("resources/objects/sonic/mapa.obj");
-	Model sonic("resources/objects/sonic/sonic.obj");
+	StaticModel &mapa = regiones.model(regionSonic, "resources/objects/sonic/mapa.obj");
+	StaticModel &sonic = regiones.model(regionSonic, "resources/objects/sonic/sonic.obj");
 	//ring
-	Model ring("resources/objects/ring/ring.obj");
+	StaticModel &ring = regiones.model(regionSonic, "resources/objects/ring/ring.obj");
 	//EggMAn
-	Model Eggman("resources/objects/Eggman/Eggman.obj");
+	StaticModel &Eggman = regiones.model(regionEggman, "resources/objects/Eggman/Eggman.obj");
 	//Freddy
-	Model Freddy("resources/objects/Freddy/Freddy.obj");
-	Model FreddyBrazo("resources/objects/Freddy/FreddyBrazo.obj");
+	StaticModel &Freddy = cargador.model("resources/objects/Freddy/Freddy.obj");
+	StaticModel &FreddyBrazo = cargador.model("resources/objects/Freddy/FreddyBrazo.obj");
 	//Chica
-	Model Chica("resources/objects/Chica/chica.obj");
-	Model ChicaBrazo("resources/objects/Chica/chicabrazo.obj");
-	Model panque("resources/objects/Chica/panque.obj");
+	StaticModel &Chica = cargador.model("resources/objects/Chica/chica.obj");
+	StaticModel &ChicaBrazo = cargador.model("resources/objects/Chica/chicabrazo.obj");
+	StaticModel &panque = cargador.model("resources/objects/Chica/panque.obj");
 	//Cheff
-	Model cheff("resources/objects/cocinero/cheff.obj");
-	Model cheffbd("resources/objects/cocinero/cheffbd.obj");
-	Model cheffbi("resources/objects/cocinero/cheffbi.obj");
-	Model sarten("resources/objects/cocinero/sarten.obj");
-	Model carne("resources/objects/cocinero/carne.obj");
-	Model plato("resources/objects/cocinero/plato.obj");
+	StaticModel &cheff = cargador.model("resources/objects/cocinero/cheff.obj");
+	StaticModel &cheffbd = cargador.model("resources/objects/cocinero/cheffbd.obj");
+	StaticModel &sarten = cargador.model("resources/objects/cocinero/sarten.obj");
+	StaticModel &carne = cargador.model("resources/objects/cocinero/carne.obj");
+	StaticModel &plato = cargador.model("resources/objects/cocinero/plato.obj");
 
 	//Bunny
-	Model Bunny("resources/objects/Bunny/cuerpoBunny.obj");
-	Model BunnyBrazoIzq("resources/objects/Bunny/bIzqBunny.obj");
-	Model BunnyBrazoDer("resources/objects/Bunny/bDerBunny.obj");
-	Model BunnyPieIzq("resources/objects/Bunny/pIzqBunny.obj");
-	Model BunnyPieDer("resources/objects/Bunny/pDerBunny.obj");
+	StaticModel &Bunny = cargador.model("resources/objects/Bunny/cuerpoBunny.obj");
+	StaticModel &BunnyBrazoIzq = cargador.model("resources/objects/Bunny/bIzqBunny.obj");
+	StaticModel &BunnyBrazoDer = cargador.model("resources/objects/Bunny/bDerBunny.obj");
+	StaticModel &BunnyPieIzq = cargador.model("resources/objects/Bunny/pIzqBunny.obj");
+	StaticModel &BunnyPieDer = cargador.model("resources/objects/Bunny/pDerBunny.obj");
 	//Globo
-	Model globo("resources/objects/globos/globodec.obj");
+	StaticModel &globo = cargador.model("resources/objects/globos/globodec.obj");
 
 	//BallonBoy
 
-	Model torsoBB("resources/objects/BallonBoy/torso.obj");
-	Model cabezaBB("resources/objects/BallonBoy/cabeza.obj");
-	Model hombroDerBB("resources/objects/BallonBoy/hombroDer.obj");
-	Model hombroIzqBB("resources/objects/BallonBoy/hombroIzq.obj");
-	Model brazoDerBB("resources/objects/BallonBoy/brazoDer.obj");
-	Model brazoIzqBB("resources/objects/BallonBoy/brazoIzq.obj");
-	Model piernaDerArrBB("resources/objects/BallonBoy/piernaDerArr.obj");
-	Model piernaDerAbBB("resources/objects/BallonBoy/piernaDerAb.obj");
-	Model piernaIzqArrBB("resources/objects/BallonBoy/piernaIzqArr.obj");
-	Model piernaIzqAbBB("resources/objects/BallonBoy/piernaDerAb.obj");
-	Model globoBB("resources/objects/BallonBoy/globo.obj");
-	Model letreroBB("resources/objects/BallonBoy/letrero.obj");
+	StaticModel &torsoBB = cargador.model("resources/objects/BallonBoy/torso.obj");
+	StaticModel &cabezaBB = cargador.model("resources/objects/BallonBoy/cabeza.obj");
+	StaticModel &hombroDerBB = cargador.model("resources/objects/BallonBoy/hombroDer.obj");
+	StaticModel &hombroIzqBB = cargador.model("resources/objects/BallonBoy/hombroIzq.obj");
+	StaticModel &brazoDerBB = cargador.model("resources/objects/BallonBoy/brazoDer.obj");
+	StaticModel &brazoIzqBB = cargador.model("resources/objects/BallonBoy/brazoIzq.obj");
+	StaticModel &piernaDerArrBB = cargador.model("resources/objects/BallonBoy/piernaDerArr.obj");
+	StaticModel &piernaDerAbBB = cargador.model("resources/objects/BallonBoy/piernaDerAb.obj");
+	StaticModel &piernaIzqArrBB = cargador.model("resources/objects/BallonBoy/piernaIzqArr.obj");
+	StaticModel &piernaIzqAbBB = cargador.model("resources/objects/BallonBoy/piernaDerAb.obj");
+	StaticModel &globoBB = cargador.model("resources/objects/BallonBoy/globo.obj");
+	StaticModel &letreroBB = cargador.model("resources/objects/BallonBoy/letrero.obj");
+
+	//El skybox carga sus caras mientras los hilos procesan los modelos
+	Skybox skybox = Skybox(faces);
+	regiones.update(camera.Position);
+	cargador.finish();
 
-	//para keyframes
-	animate();
-	//Inicialización de KeyFrames
-
-	KeyFrame[0].movGlobo_x = 0.0f;
-	KeyFrame[0].movGlobo_y = 0.0f;
-	KeyFrame[0].movGlobo_z = 0.0f;
-	KeyFrame[0].giroGlobo = 0;
-
-
-	KeyFrame[1].movGlobo_x = 0.0f;
-	KeyFrame[1].movGlobo_y = 10.0f;
-	KeyFrame[1].movGlobo_z = 0.0f;
-	KeyFrame[1].giroGlobo = 0;
-
-
-	KeyFrame[2].movGlobo_x = 5.0f;
-	KeyFrame[2].movGlobo_y = 6.0f;
-	KeyFrame[2].movGlobo_z = 0.0f;
-	KeyFrame[2].giroGlobo = 0;
-
-
-	KeyFrame[3].movGlobo_x = 7.0f;
-	KeyFrame[3].movGlobo_y = 10.0f;
-	KeyFrame[3].movGlobo_z = 0.0f;
-	KeyFrame[3].giroGlobo = 0;
-
-	KeyFrame[4].movGlobo_x = 9.0f;
-	KeyFrame[4].movGlobo_y = 6.0f;
-	KeyFrame[4].movGlobo_z = 0.0f;
-	KeyFrame[4].giroGlobo = 0.0f;
-
-	KeyFrame[5].movGlobo_x = 11.0f;
-	KeyFrame[5].movGlobo_y = 10.0f;
-	KeyFrame[5].movGlobo_z = 0.0f;
-	KeyFrame[5].giroGlobo = 0;
-
-	KeyFrame[6].movGlobo_x = 13.0f;
-	KeyFrame[6].movGlobo_y = 6.0f;
-	KeyFrame[6].movGlobo_z = 0.0f;
-	KeyFrame[6].giroGlobo = 0;
-
-	KeyFrame[7].movGlobo_x = 15.0f;
-	KeyFrame[7].movGlobo_y = 10.0f;
-	KeyFrame[7].movGlobo_z = 0.0f;
-	KeyFrame[7].giroGlobo = 0;
-
-	KeyFrame[8].movGlobo_x = 17.0f;
-	KeyFrame[8].movGlobo_y = 6.0f;
-	KeyFrame[8].movGlobo_z = 0.0f;
-	KeyFrame[8].giroGlobo = 90;
-
-	KeyFrame[9].movGlobo_x = 19.0f;
-	KeyFrame[9].movGlobo_y = 10.0f;
-	KeyFrame[9].movGlobo_z = -4.0f;
-	KeyFrame[9].giroGlobo = 90;
-
-	KeyFrame[10].movGlobo_x = 19.0f;
-	KeyFrame[10].movGlobo_y = 6.0f;
-	KeyFrame[10].movGlobo_z = -8.0f;
-	KeyFrame[10].giroGlobo = 90;
-
-	KeyFrame[11].movGlobo_x = 19.0f;
-	KeyFrame[11].movGlobo_y = 10.0f;
-	KeyFrame[11].movGlobo_z = -12.0f;
-	KeyFrame[11].giroGlobo = 90;
-
-	KeyFrame[12].movGlobo_x = 19.0f;
-	KeyFrame[12].movGlobo_y = 6.0f;
-	KeyFrame[12].movGlobo_z = -16.0f;
-	KeyFrame[12].giroGlobo = 90;
-
-	KeyFrame[13].movGlobo_x = 19.0f;
-	KeyFrame[13].movGlobo_y = 10.0f;
-	KeyFrame[13].movGlobo_z = -20.0f;
-	KeyFrame[13].giroGlobo = 90;
-
-	KeyFrame[14].movGlobo_x = 19.0f;
-	KeyFrame[14].movGlobo_y = 6.0f;
-	KeyFrame[14].movGlobo_z = -24.0f;
-	KeyFrame[14].giroGlobo = 90;
-
-	KeyFrame[15].movGlobo_x = 19.0f;
-	KeyFrame[15].movGlobo_y = 10.0f;
-	KeyFrame[15].movGlobo_z = -28.0f;
-	KeyFrame[15].giroGlobo = 90;
-
-	KeyFrame[16].movGlobo_x = 19.0f;
-	KeyFrame[16].movGlobo_y = 6.0f;
-	KeyFrame[16].movGlobo_z = -32.0f;
-	KeyFrame[16].giroGlobo = 90;
-
-	KeyFrame[17].movGlobo_x = 19.0f;
-	KeyFrame[17].movGlobo_y = 10.0f;
-	KeyFrame[17].movGlobo_z = -36.0f;
-	KeyFrame[17].giroGlobo = 90;
-
-	KeyFrame[18].movGlobo_x = 19.0f;
-	KeyFrame[18].movGlobo_y = 6.0f;
-	KeyFrame[18].movGlobo_z = -40.0f;
-	KeyFrame[18].giroGlobo = 90;
-
-	KeyFrame[19].movGlobo_x = 19.0f;
-	KeyFrame[19].movGlobo_y = 5.0f;
-	KeyFrame[19].movGlobo_z = -44.0f;
-	KeyFrame[19].giroGlobo = 90;
-
-	KeyFrame[20].movGlobo_x = 19.0f;
-	KeyFrame[20].movGlobo_y = 4.0f;
-	KeyFrame[20].movGlobo_z = -48.0f;
-	KeyFrame[20].giroGlobo = 90;
-
-	KeyFrame[21].movGlobo_x = 19.0f;
-	KeyFrame[21].movGlobo_y = 3.0f;
-	KeyFrame[21].movGlobo_z = -52.0f;
-	KeyFrame[21].giroGlobo = 90;
-
-	KeyFrame[22].movGlobo_x = 19.0f;
-	KeyFrame[22].movGlobo_y = 2.0f;
-	KeyFrame[22].movGlobo_z = -56.0f;
-	KeyFrame[22].giroGlobo = 90;
-
-	KeyFrame[23].movGlobo_x = 19.0f;
-	KeyFrame[23].movGlobo_y = 1.0f;
-	KeyFrame[23].movGlobo_z = -60.0f;
-	KeyFrame[23].giroGlobo = 90;
-
-	KeyFrame[24].movGlobo_x = 19.0f;
-	KeyFrame[24].movGlobo_y = 0.0f;
-	KeyFrame[24].movGlobo_z = -64.0f;
-	KeyFrame[24].giroGlobo = 90;
-
-	KeyFrame[25].movGlobo_x = 19.0f;
-	KeyFrame[25].movGlobo_y = 0.0f;
-	KeyFrame[25].movGlobo_z = -68.0f;
-	KeyFrame[25].giroGlobo = 90;
-	
-	KeyFrame[26].movGlobo_x = 19.0f;
-	KeyFrame[26].movGlobo_y = 0.0f;
-	KeyFrame[26].movGlobo_z = -68.0f;
-	KeyFrame[26].giroGlobo = 180;
-	
-	KeyFrame[27].movGlobo_x = 15.0f;
-	KeyFrame[27].movGlobo_y = 1.0f;
-	KeyFrame[27].movGlobo_z = -68.0f;
-	KeyFrame[27].giroGlobo = 180;
-
-	KeyFrame[28].movGlobo_x = 11.0f;
-	KeyFrame[28].movGlobo_y = 2.f;
-	KeyFrame[28].movGlobo_z = -68.0f;
-	KeyFrame[28].giroGlobo = 180;
-
-	KeyFrame[29].movGlobo_x = 7.0f;
-	KeyFrame[29].movGlobo_y = 3.0f;
-	KeyFrame[29].movGlobo_z = -68.0f;
-	KeyFrame[29].giroGlobo = 180;
-
-	KeyFrame[30].movGlobo_x = 3.0f;
-	KeyFrame[30].movGlobo_y = 4.0f;
-	KeyFrame[30].movGlobo_z = -68.0f;
-	KeyFrame[30].giroGlobo = 180;
-
-	KeyFrame[31].movGlobo_x = -1.0f;
-	KeyFrame[31].movGlobo_y = 5.0f;
-	KeyFrame[31].movGlobo_z = -68.0f;
-	KeyFrame[31].giroGlobo = 180;
-
-	KeyFrame[32].movGlobo_x = -5.0f;
-	KeyFrame[32].movGlobo_y = 6.0f;
-	KeyFrame[32].movGlobo_z = -68.0f;
-	KeyFrame[32].giroGlobo = 180;
-	
-	KeyFrame[33].movGlobo_x = -5.0f;
-	KeyFrame[33].movGlobo_y = 6.0f;
-	KeyFrame[33].movGlobo_z = -68.0f;
-	KeyFrame[33].giroGlobo = 270;
-	
-	KeyFrame[34].movGlobo_x = -5.0f;
-	KeyFrame[34].movGlobo_y = 10.0f;
-	KeyFrame[34].movGlobo_z = -60.0f;
-	KeyFrame[34].giroGlobo = 270;
-
-	KeyFrame[35].movGlobo_x = -5.0f;
-	KeyFrame[35].movGlobo_y = 6.0f;
-	KeyFrame[35].movGlobo_z = -52.0f;
-	KeyFrame[35].giroGlobo = 270;
-
-	KeyFrame[36].movGlobo_x = -5.0f;
-	KeyFrame[36].movGlobo_y = 10.0f;
-	KeyFrame[36].movGlobo_z = -44.0f;
-	KeyFrame[36].giroGlobo = 270;
-
-	KeyFrame[37].movGlobo_x = -5.0f;
-	KeyFrame[37].movGlobo_y = 6.0f;
-	KeyFrame[37].movGlobo_z = -36.0f;
-	KeyFrame[37].giroGlobo = 270;
-
-	KeyFrame[38].movGlobo_x = -5.0f;
-	KeyFrame[38].movGlobo_y = 10.0f;
-	KeyFrame[38].movGlobo_z = -28.0f;
-	KeyFrame[38].giroGlobo = 270;
-
-	KeyFrame[39].movGlobo_x = -5.0f;
-	KeyFrame[39].movGlobo_y = 6.0f;
-	KeyFrame[39].movGlobo_z = -20.0f;
-	KeyFrame[39].giroGlobo = 270;
-
-	KeyFrame[40].movGlobo_x = -5.0f;
-	KeyFrame[40].movGlobo_y = 10.0f;
-	KeyFrame[40].movGlobo_z = -12.0f;
-	KeyFrame[40].giroGlobo = 270;
-
-	KeyFrame[41].movGlobo_x = -5.0f;
-	KeyFrame[41].movGlobo_y = 6.0f;
-	KeyFrame[41].movGlobo_z = -4.0f;
-	KeyFrame[41].giroGlobo = 270;
-
-	KeyFrame[42].movGlobo_x = -5.0f;
-	KeyFrame[42].movGlobo_y = 5.0f;
-	KeyFrame[42].movGlobo_z = 0.0f;
-	KeyFrame[42].giroGlobo = 270;
-	
-	KeyFrame[43].movGlobo_x = -5.0f;
-	KeyFrame[43].movGlobo_y = 5.0f;
-	KeyFrame[43].movGlobo_z = 0.0f;
-	KeyFrame[43].giroGlobo = 360;
-	
-	KeyFrame[44].movGlobo_x = -5.0f;
-	KeyFrame[44].movGlobo_y = 0.0f;
-	KeyFrame[44].movGlobo_z = 0.0f;
-	KeyFrame[44].giroGlobo = 360;
-	
-	KeyFrame[45].movGlobo_x = 0.0f;
-	KeyFrame[45].movGlobo_y = 0.0f;
-	KeyFrame[45].movGlobo_z = 0.0f;
-	KeyFrame[45].giroGlobo = 360;
+	//--------------------------------------------------------------------------------
+	//Tabla de la escena
+	/*Cada objeto se agrega con su posicion, escala y rotacion (en ese orden de parametros),
+	los objetos con padre se colocan relativos a el. Las rotaciones y posiciones que
+	cambian por animacion se actualizan en cada paso de simulacion en actualizaEscena().
+	Los grupos solo separan el dibujo para medir cuanto tarda cada parte*/
+	//--------------------------------------------------------------------------------
+	const glm::vec3 ejeY(0.0f, 1.0f, 0.0f);
+	const glm::quat sinGiro(1.0f, 0.0f, 0.0f, 0.0f);
+
+	//Restaurante y mesas
+	escena.useGroup("Restaurante");
+	escena.add(restaurante, glm::vec3(0.0f, -0.7f, -100.0f), 4.0f, axisAngle(-90.0f, ejeY));
+	escena.add(mesa, glm::vec3(-30.0f, 0.0f, -170.0f), 6.0f, axisAngle(-90.0f, ejeY), -1, SCENE_INSTANCED);
+	escena.add(mesa, glm::vec3(30.0f, 0.0f, -170.0f), 6.0f, axisAngle(-90.0f, ejeY), -1, SCENE_INSTANCED);
+	escena.add(mesa, glm::vec3(30.0f, 0.0f, -100.0f), 6.0f, axisAngle(-90.0f, ejeY), -1, SCENE_INSTANCED);
+	escena.add(mesa, glm::vec3(-30.0f, 0.0f, -100.0f), 6.0f, axisAngle(-90.0f, ejeY), -1, SCENE_INSTANCED);
+	escena.add(pastel, glm::vec3(-30.0f, 11.0f, -170.0f), 2.0f, axisAngle(-90.0f, ejeY));
 
+	//Sonic
+	escena.useGroup("Sonic");
+	escena.add(mapa, glm::vec3(300.0f, 5.0f, 150.0f), 8.0f, axisAngle(90.0f, ejeY));
+	idSonic = escena.add(sonic, glm::vec3(340.0f, 11.0f, 0.0f), 3.0f, sinGiro, -1, SCENE_DYNAMIC);
+
+	//Rings
+	idRing[0] = escena.add(ring, glm::vec3(340.0f, 10.0f, 150.0f), 4.0f, sinGiro, -1, SCENE_INSTANCED | SCENE_DYNAMIC);
+	idRing[1] = escena.add(ring, glm::vec3(340.0f, 10.0f, 100.0f), 4.0f, sinGiro, -1, SCENE_INSTANCED | SCENE_DYNAMIC);
+	idRing[2] = escena.add(ring, glm::vec3(340.0f, 10.0f, 50.0f), 4.0f, sinGiro, -1, SCENE_INSTANCED | SCENE_DYNAMIC);
+	idRing[3] = escena.add(ring, glm::vec3(250.0f, 10.0f, 150.0f), 4.0f, sinGiro, -1, SCENE_INSTANCED | SCENE_DYNAMIC);
+	idRing[4] = escena.add(ring, glm::vec3(250.0f, 10.0f, 200.0f), 4.0f, sinGiro, -1, SCENE_INSTANCED | SCENE_DYNAMIC);
+	idRing[5] = escena.add(ring, glm::vec3(250.0f, 10.0f, 250.0f), 4.0f, sinGiro, -1, SCENE_INSTANCED | SCENE_DYNAMIC);
+
+	//Microfono
+	escena.useGroup("Restaurante");
+	escena.add(micro, glm::vec3(100.0f, 7.5f, -110.0f), 150.0f, axisAngle(-90.0f, ejeY));
+
+	//Cocina
+	escena.add(cocina, glm::vec3(-165.0f, 0.0f, 10.0f), 13.0f, axisAngle(180.0f, ejeY), -1, SCENE_INSTANCED);
+	escena.add(cocina, glm::vec3(-220.0f, 0.0f, 10.0f), 13.0f, axisAngle(180.0f, ejeY), -1, SCENE_INSTANCED);
+	escena.add(mesa, glm::vec3(-180.0f, 0.0f, -70.0f), 6.0f, axisAngle(-90.0f, ejeY), -1, SCENE_INSTANCED);
+
+	//Mesa bar y cortinas
+	escena.add(bar, glm::vec3(-55.0f, 0.0f, -10.0f), 2.0f, axisAngle(-90.0f, ejeY));
+	escena.add(cortina, glm::vec3(123.0f, 7.0f, -115.0f), 11.0f, axisAngle(-90.0f, ejeY));
+
+	//Arcade
+	escena.add(Arcade1, glm::vec3(180.0f, 0.0f, -10.0f), 10.0f, axisAngle(-90.0f, ejeY), -1, SCENE_INSTANCED);
+	escena.add(Arcade1, glm::vec3(180.0f, 0.0f, 10.0f), 10.0f, axisAngle(-90.0f, ejeY), -1, SCENE_INSTANCED);
+	escena.add(Arcade2, glm::vec3(140.0f, 0.0f, -35.0f), 0.4f, sinGiro, -1, SCENE_INSTANCED);
+	escena.add(Arcade2, glm::vec3(160.0f, 0.0f, -35.0f), 0.4f, sinGiro, -1, SCENE_INSTANCED);
+	escena.add(Arcade3, glm::vec3(140.0f, 0.0f, 33.0f), 1.15f, axisAngle(90.0f, ejeY), -1, SCENE_INSTANCED);
+	escena.add(Arcade3, glm::vec3(160.0f, 0.0f, 33.0f), 1.15f, axisAngle(90.0f, ejeY), -1, SCENE_INSTANCED);
+
+	/*Las piezas de los personajes cuelgan de su cuerpo: guardan solo su posicion y giro respecto
+	a el (en unidades del cuerpo, de ahi la division entre su escala) y la escena encadena las matrices*/
+	//Freddy
+	escena.useGroup("Animatronicos");
+	idFreddy = escena.add(Freddy, glm::vec3(40.0f, 0.0f, 50.0f), 10.0f);
+	idFreddyBrazo = escena.add(FreddyBrazo, glm::vec3(7.0f, 34.5f, -2.0f) / 10.0f, 1.0f, sinGiro, idFreddy, SCENE_DYNAMIC);
 
-	//Inicialización de KeyFrames
-	for (int i = 0; i < MAX_FRAMES; i++)
-	{
+	//Eggman
+	escena.useGroup("Sonic");
+	idEggman = escena.add(Eggman, glm::vec3(0.0f), 3.0f, sinGiro, -1, SCENE_DYNAMIC);
+
+	//Chica
+	escena.useGroup("Animatronicos");
+	idChica = escena.add(Chica, glm::vec3(0.0f, 0.0f, -220.0f), 0.3f);
+	idChicaBrazo = escena.add(ChicaBrazo, glm::vec3(-4.5f, 17.0f, 1.5f) / 0.3f, 1.0f, sinGiro, idChica, SCENE_DYNAMIC);
+	idPanque = escena.add(panque, glm::vec3(-4.5f, 18.5f, -212.0f), 0.025f, sinGiro, -1, SCENE_DYNAMIC);
+
+	//Cheff
+	int idCheff = escena.add(cheff, glm::vec3(-180.0f, 0.0f, 0.0f), 14.0f);
+	idCheffBD = escena.add(cheffbd, glm::vec3(-2.0f, 13.5f, 0.0f) / 14.0f, 1.0f, sinGiro, idCheff, SCENE_DYNAMIC);
+	idCheffBI = escena.add(cheffbd, glm::vec3(2.0f, 13.5f, 0.0f) / 14.0f, 1.0f, sinGiro, idCheff, SCENE_DYNAMIC);
+	idSarten = escena.add(sarten, glm::vec3(-180.0f, 13.5f, 7.0f), 1.0f, sinGiro, -1, SCENE_DYNAMIC);
+	escena.add(plato, glm::vec3(-180.0f, 11.2f, -70.0f), 2.0f, axisAngle(-90.0f, ejeY));
+	idCarne = escena.add(carne, glm::vec3(-180.0f, 13.5f, 0.0f), 1.0f, axisAngle(-90.0f, ejeY), -1, SCENE_DYNAMIC);
+
+	//Bunny
+	int idBunny = escena.add(Bunny, glm::vec3(-85.0f, -0.5f, -10.0f), 7.0f, axisAngle(90.0f, ejeY));
+	idBunnyBI = escena.add(BunnyBrazoIzq, glm::vec3(0.0f), 1.0f, sinGiro, idBunny, SCENE_DYNAMIC);
+	idBunnyBD = escena.add(BunnyBrazoDer, glm::vec3(0.0f), 1.0f, sinGiro, idBunny, SCENE_DYNAMIC);
+	idBunnyPI = escena.add(BunnyPieIzq, glm::vec3(0.0f), 1.0f, sinGiro, idBunny, SCENE_DYNAMIC);
+	idBunnyPD = escena.add(BunnyPieDer, glm::vec3(0.0f), 1.0f, sinGiro, idBunny, SCENE_DYNAMIC);
+
+	//Globo
+	idGlobo = escena.add(globo, glm::vec3(posX_globo, posy_globo, posz_globo), 0.3f, sinGiro, -1, SCENE_DYNAMIC);
 
+	//Pasto Diorama
+	escena.useGroup("Restaurante");
+	int idPiso = escena.add(piso, glm::vec3(0.0f, -13.25f, 0.0f), 50.0f);
+
+	//BallonBoy
+	escena.useGroup("BallonBoy");
+	/*Cada articulacion es un pivote sin modelo, la pieza se dibuja desplazada
+	respecto a su pivote. El cuerpo cuelga del pasto como en el dibujo original*/
+	int baseBB = escena.add(glm::vec3(100.0f, 15.0f, 100.0f), 0.65f, sinGiro, idPiso);
+	idTorsoBB = escena.add(torsoBB, glm::vec3(0.0f), 1.0f, sinGiro, baseBB, SCENE_DYNAMIC);
+	idCabezaBB = escena.add(glm::vec3(0.0f, 10.5f, 1.5f), 1.0f, sinGiro, idTorsoBB);
+	escena.add(cabezaBB, glm::vec3(0.0f, 10.5f, 1.5f), 1.0f, sinGiro, idCabezaBB);
+	idHombroDerBB = escena.add(glm::vec3(3.0f, 4.0f, 0.0f), 1.0f, sinGiro, idTorsoBB);
+	int hombroDer = escena.add(hombroDerBB, glm::vec3(3.0f, 0.0f, 0.0f), 1.0f, sinGiro, idHombroDerBB);
+	idBrazoDerBB = escena.add(glm::vec3(6.0f, 0.0f, 0.0f), 1.0f, sinGiro, hombroDer);
+	escena.add(brazoDerBB, glm::vec3(1.0f, 0.0f, 0.0f), 1.0f, sinGiro, idBrazoDerBB);
+	idHombroIzqBB = escena.add(glm::vec3(-3.0f, 4.0f, 0.0f), 1.0f, sinGiro, idTorsoBB);
+	int hombroIzq = escena.add(hombroIzqBB, glm::vec3(-3.0f, 0.0f, 0.0f), 1.0f, sinGiro, idHombroIzqBB);
+	idBrazoIzqBB = escena.add(glm::vec3(-5.0f, 0.0f, 0.0f), 1.0f, sinGiro, hombroIzq);
+	escena.add(brazoIzqBB, glm::vec3(-1.0f, 0.0f, 0.0f), 1.0f, sinGiro, idBrazoIzqBB);
+	idPiernaDerBB = escena.add(glm::vec3(5.0f, -7.0f, 0.0f), 1.0f, sinGiro, idTorsoBB);
+	int piernaDer = escena.add(piernaDerArrBB, glm::vec3(1.0f, 1.0f, 0.0f), 1.0f, sinGiro, idPiernaDerBB);
+	idRodDerBB = escena.add(glm::vec3(0.0f, -10.0f, -0.5f), 1.0f, sinGiro, piernaDer);
+	escena.add(piernaDerAbBB, glm::vec3(0.0f, 2.0f, -0.5f), 1.0f, sinGiro, idRodDerBB);
+	idPiernaIzqBB = escena.add(glm::vec3(-5.0f, -7.0f, 0.0f), 1.0f, sinGiro, idTorsoBB);
+	int piernaIzq = escena.add(piernaIzqArrBB, glm::vec3(-1.0f, 1.0f, 0.0f), 1.0f, sinGiro, idPiernaIzqBB);
+	idRodIzqBB = escena.add(glm::vec3(0.0f, -10.0f, -0.5f), 1.0f, sinGiro, piernaIzq);
+	escena.add(piernaIzqAbBB, glm::vec3(0.0f, 2.0f, -0.5f), 1.0f, sinGiro, idRodIzqBB);
+	idGloboBB = escena.add(globoBB, glm::vec3(-9.55f, 0.0f, -0.5f), 1.0f, sinGiro, idBrazoIzqBB);
+	idLetreroBB = escena.add(letreroBB, glm::vec3(9.55f, 0.0f, -0.5f), 1.0f, sinGiro, idBrazoDerBB);
+
+	//para keyframes
+	defineMaquinas();
+	horneaAnimaciones();
+	creaPersonajes();
+	animate();
+	//Keyframes del globo: x, y, z y giro, uno cada SEGUNDOS_POR_FRAME segundos. Sin archivo se
+	//usan los de la tabla y se guardan para las siguientes ejecuciones
+	if (takeGlobo.open(RUTA_TAKE_GLOBO) && takeGlobo.channels() == animaciones.channels(clipGlobo))
+		animaciones.stream(clipGlobo, &takeGlobo);
+	else
+	{
+		const float keysGlobo[][4] = {
+			{ 0.0f, 0.0f, 0.0f, 0.0f },
+			{ 0.0f, 10.0f, 0.0f, 0.0f },
+			{ 5.0f, 6.0f, 0.0f, 0.0f },
+			{ 7.0f, 10.0f, 0.0f, 0.0f },
+			{ 9.0f, 6.0f, 0.0f, 0.0f },
+			{ 11.0f, 10.0f, 0.0f, 0.0f },
+			{ 13.0f, 6.0f, 0.0f, 0.0f },
+			{ 15.0f, 10.0f, 0.0f, 0.0f },
+			{ 17.0f, 6.0f, 0.0f, 90.0f },
+			{ 19.0f, 10.0f, -4.0f, 90.0f },
+			{ 19.0f, 6.0f, -8.0f, 90.0f },
+			{ 19.0f, 10.0f, -12.0f, 90.0f },
+			{ 19.0f, 6.0f, -16.0f, 90.0f },
+			{ 19.0f, 10.0f, -20.0f, 90.0f },
+			{ 19.0f, 6.0f, -24.0f, 90.0f },
+			{ 19.0f, 10.0f, -28.0f, 90.0f },
+			{ 19.0f, 6.0f, -32.0f, 90.0f },
+			{ 19.0f, 10.0f, -36.0f, 90.0f },
+			{ 19.0f, 6.0f, -40.0f, 90.0f },
+			{ 19.0f, 5.0f, -44.0f, 90.0f },
+			{ 19.0f, 4.0f, -48.0f, 90.0f },
+			{ 19.0f, 3.0f, -52.0f, 90.0f },
+			{ 19.0f, 2.0f, -56.0f, 90.0f },
+			{ 19.0f, 1.0f, -60.0f, 90.0f },
+			{ 19.0f, 0.0f, -64.0f, 90.0f },
+			{ 19.0f, 0.0f, -68.0f, 90.0f },
+			{ 19.0f, 0.0f, -68.0f, 180.0f },
+			{ 15.0f, 1.0f, -68.0f, 180.0f },
+			{ 11.0f, 2.0f, -68.0f, 180.0f },
+			{ 7.0f, 3.0f, -68.0f, 180.0f },
+			{ 3.0f, 4.0f, -68.0f, 180.0f },
+			{ -1.0f, 5.0f, -68.0f, 180.0f },
+			{ -5.0f, 6.0f, -68.0f, 180.0f },
+			{ -5.0f, 6.0f, -68.0f, 270.0f },
+			{ -5.0f, 10.0f, -60.0f, 270.0f },
+			{ -5.0f, 6.0f, -52.0f, 270.0f },
+			{ -5.0f, 10.0f, -44.0f, 270.0f },
+			{ -5.0f, 6.0f, -36.0f, 270.0f },
+			{ -5.0f, 10.0f, -28.0f, 270.0f },
+			{ -5.0f, 6.0f, -20.0f, 270.0f },
+			{ -5.0f, 10.0f, -12.0f, 270.0f },
+			{ -5.0f, 6.0f, -4.0f, 270.0f },
+			{ -5.0f, 5.0f, 0.0f, 270.0f },
+			{ -5.0f, 5.0f, 0.0f, 360.0f },
+			{ -5.0f, 0.0f, 0.0f, 360.0f },
+			{ 0.0f, 0.0f, 0.0f, 360.0f }
+		};
+		for (unsigned int k = 0; k < sizeof(keysGlobo) / sizeof(keysGlobo[0]); k++)
+			for (unsigned int c = 0; c < 4; c++)
+				animaciones.addKey(clipGlobo, c, k * SEGUNDOS_POR_FRAME, keysGlobo[k][c]);
+		writeTake(RUTA_TAKE_GLOBO, animaciones, clipGlobo);
 	}
 
 	glm::mat4 projection = glm::perspective(camera.getZoom(), (float)SCR_WIDTH/(float)SCR_HEIGHT, 0.1f, 1000.0f);
+	FixedTimestep simulacion(FPS);
+
+	//Recorrido del benchmark: cruza el restaurante, rodea el diorama de Sonic y regresa (unos 15 s a 60 pasos por segundo)
+	CameraTour recorrido(glm::vec3(0.0f, 15.0f, 350.0f), -90.0f);
+	recorrido.add(-90.0f, 1.0f, 150);
+	recorrido.add(-45.0f, 1.0f, 120);
+	recorrido.add(0.0f, 1.2f, 120);
+	recorrido.add(90.0f, 1.2f, 150);
+	recorrido.add(180.0f, 1.5f, 240);
+	recorrido.add(270.0f, 1.0f, 150);
+	BenchmarkRecorder medicion;
+	unsigned int cuadrosBenchmark = 0;
+	if (modoBenchmark)
+	{
+		if (pasosBenchmark == 0)
+			pasosBenchmark = recorrido.length();
+		recorrido.restart(camera);
+		medicion.reserve(pasosBenchmark);
+		ritmo.setRate(0.0);
+	}
 	// render loop
 	// -----------
 	while (!glfwWindowShouldClose(window))
 	{
-		skyboxShader.setInt("skybox", 0);
-
 		if (!camera.getIsometric()) {
 			projection = glm::perspective(camera.getZoom(), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 1000.0f);
 		}
@@ -969,12 +1181,33 @@ int main()
 
 		// per-frame time logic
 		// --------------------
-		lastFrame = SDL_GetTicks();
+		deltaTime = ritmo.frame() * 1000.0; // time for full 1 loop, in milliseconds
+		double ahora = FramePacer::now();
+		perfil.beginFrame();
+		drawCounters().calls = 0;
+		drawCounters().triangles = 0;
 
 		// input
 		// -----
 		//my_input(window);
-		animate();
+
+		// simulation
+		// ----------
+		//Las animaciones avanzan en pasos fijos de 1/FPS segundos sin importar cuantos cuadros
+		//se dibujen, la escena interpola entre los dos ultimos pasos
+		perfil.begin("animate");
+		unsigned int pasos = modoBenchmark ? 1 : simulacion.advance(ahora);
+		float mezcla = modoBenchmark ? 1.0f : simulacion.alpha();
+		for (unsigned int p = 0; p < pasos; p++)
+		{
+			if (modoBenchmark)
+				recorrido.advance(camera);
+			escena.step();
+			animate();
+			actualizaEscena();
+		}
+		sigueCamara();
+		perfil.end();
 
 		// render
 		// ------
@@ -982,59 +1215,18 @@ int main()
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		// don't forget to enable shader before setting uniforms
+		perfil.begin("Luces");
 		staticShader.use();
-		//Setup Advanced Lights
-		staticShader.setVec3("viewPos", camera.Position);
-		staticShader.setVec3("dirLight.direction", lightDirection);
-		staticShader.setVec3("dirLight.ambient", glm::vec3(luzx, luzy, luzz));//Da luz a todo
-		staticShader.setVec3("dirLight.diffuse", glm::vec3(0.0f, 0.0f, 0.0f));	//Da luz desde un únto
-		staticShader.setVec3("dirLight.specular", glm::vec3(0.0f, 0.0f, 0.0f));	//Brillo sobre una superficie
-
-		staticShader.setVec3("pointLight[0].position", lightPosition);
-		staticShader.setVec3("pointLight[0].ambient", glm::vec3(0.2f, 0.2f, 0.2f));
-		staticShader.setVec3("pointLight[0].diffuse", glm::vec3(1.0f, 1.0f, 0.0f));
-		staticShader.setVec3("pointLight[0].specular", glm::vec3(0.0f, 0.0f, 0.0f));
-		staticShader.setFloat("pointLight[0].constant", 0.008f); //Potencia de la luz
-		staticShader.setFloat("pointLight[0].linear", 0.009f); //distancia de luz, control mas fino
-		staticShader.setFloat("pointLight[0].quadratic", 0.032f);//distancia de luz, es mas brusco, a mas pequeño menor atenuacion mas viaja la luz
-
-		staticShader.setVec3("pointLight[1].position", glm::vec3(-80.0, 0.0f, 0.0f));
-		staticShader.setVec3("pointLight[1].ambient", glm::vec3(0.0f, 0.2f, 0.0f));
-		staticShader.setVec3("pointLight[1].diffuse", myColor01);
-		staticShader.setVec3("pointLight[1].specular", glm::vec3(0.0f, 0.0f, 0.0f));
-		staticShader.setFloat("pointLight[1].constant", 1.0f);
-		staticShader.setFloat("pointLight[1].linear", 0.009f);
-		staticShader.setFloat("pointLight[1].quadratic", 0.00000032f);
-
-		staticShader.setVec3("pointLight[2].position", myposition02);
-		staticShader.setVec3("pointLight[2].ambient", glm::vec3(0.0f, 0.2f, 0.0f));
-		staticShader.setVec3("pointLight[2].diffuse", glm::vec3(0.0f, 0.0f, 1.0f));
-		staticShader.setVec3("pointLight[2].specular", glm::vec3(0.0f, 0.0f, 0.0f));
-		staticShader.setFloat("pointLight[2].constant", 1.0f);
-		staticShader.setFloat("pointLight[2].linear", 0.009f);
-		staticShader.setFloat("pointLight[2].quadratic", 0.0000032f);
-
-		//fuente de luz reflector
-		staticShader.setVec3("spotLight[0].position", glm::vec3(camera.Position.x, camera.Position.y, camera.Position.z));//Posicion	
-		staticShader.setVec3("spotLight[0].direction", glm::vec3(camera.Front.x, camera.Front.y, camera.Front.z));//Direccion a donde apunta la luz
-		staticShader.setVec3("spotLight[0].ambient", glm::vec3(0.3f, 0.3f, 0.3f));//
-		staticShader.setVec3("spotLight[0].diffuse", glm::vec3(1.0f, 1.0f, 1.0f));
-		staticShader.setVec3("spotLight[0].specular", glm::vec3(0.0f, 0.0f, 0.0f));
-		staticShader.setFloat("spotLight[0].cutOff", glm::cos(glm::radians(10.0f)));//Maxima iluminacion
-		staticShader.setFloat("spotLight[0].outerCutOff", glm::cos(glm::radians(20.0f)));//Disminucion de la intensidad
-		staticShader.setFloat("spotLight[0].constant", 0.5f);
-		staticShader.setFloat("spotLight[0].linear", 0.0009f);//Distancia que viajara la luz
-		staticShader.setFloat("spotLight[0].quadratic", 0.005);
-
-		staticShader.setFloat("material_shininess", 32.0f);
-
-		glm::mat4 model = glm::mat4(1.0f);
-		glm::mat4 tmp = glm::mat4(1.0f);
+		configuraLuces();
+		staticUniforms.setVec3(Uniform::viewPos, camera.Position);
+		luces.apply(staticUniforms);
+		instShader.use();
+		instUniforms.setVec3(Uniform::viewPos, camera.Position);
+		luces.apply(instUniforms);
+
 		// view/projection transformations
 		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 10000.0f);
 		glm::mat4 view = camera.GetViewMatrix();
-		staticShader.setMat4("projection", projection);
-		staticShader.setMat4("view", view);
 
 		//// Light
 		glm::vec3 lightColor = glm::vec3(0.6f);
@@ -1047,8 +1239,10 @@ int main()
 		// -------------------------------------------------------------------------------------------------------------------------
 		//Remember to activate the shader with the animation
 		animShader.use();
-		animShader.setMat4("projection", projection);
-		animShader.setMat4("view", view);
+		animUniforms.setMat4(Uniform::projection, projection);
+		animUniforms.setMat4(Uniform::view, view);
+		luces.apply(animUniforms);
+		perfil.end();
 
 		//animShader.setVec3("material.specular", glm::vec3(0.5f));
 		//animShader.setFloat("material.shininess", 32.0f);
@@ -1062,746 +1256,35 @@ int main()
 		// -------------------------------------------------------------------------------------------------------------------------
 		// Escenario
 		// -------------------------------------------------------------------------------------------------------------------------
-		staticShader.use();
-		staticShader.setMat4("projection", projection);
-		staticShader.setMat4("view", view);
+		instShader.use();
+		instUniforms.setMat4(Uniform::projection, projection);
+		instUniforms.setMat4(Uniform::view, view);
 
+		staticShader.use();
+		staticUniforms.setMat4(Uniform::projection, projection);
+		staticUniforms.setMat4(Uniform::view, view);
 
-		// Restaurante
-		// -------------------------------------------------------------------------------------------------------------------------
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(0.0f, -0.7f, -100.0f));
-		model = glm::scale(model, glm::vec3(4.0f));
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		restaurante.Draw(staticShader);
-
-		//Mesas
-		// -------------------------------------------------------------------------------------------------------------------------
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(-30.0f, 0.0f, -170.0f));
-		model = glm::scale(model, glm::vec3(6.0f));
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		mesa.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(30.0f, 0.0f, -170.0f));
-		model = glm::scale(model, glm::vec3(6.0f));
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		mesa.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(30.0f, 0.0f, -100.0f));
-		model = glm::scale(model, glm::vec3(6.0f));
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		mesa.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(-30.0f, 0.0f, -100.0f));
-		model = glm::scale(model, glm::vec3(6.0f));
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		mesa.Draw(staticShader);
-
-		//Pastel
-		// -------------------------------------------------------------------------------------------------------------------------
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(-30.0f, 11.0f, -170.0f));
-		model = glm::scale(model, glm::vec3(2.0));
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		pastel.Draw(staticShader);
-
-		//Sillas
-		// -------------------------------------------------------------------------------------------------------------------------
-		/*model = glm::translate(glm::mat4(1.0f), glm::vec3(15.0f, 0.0f, 0.0f));
-		model = glm::scale(model, glm::vec3(30.0));
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		silla.Draw(staticShader);
-
-		model = glm::translate(glm::mat4(1.0f), glm::vec3(15.0f, 0.0f, 10.0f));
-		model = glm::scale(model, glm::vec3(30.0));
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		silla.Draw(staticShader);
-
-		model = glm::translate(glm::mat4(1.0f), glm::vec3(15.0f, 0.0f, -10.0f));
-		model = glm::scale(model, glm::vec3(30.0));
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		silla.Draw(staticShader);*/
-
-		//Sonic
-		// -------------------------------------------------------------------------------------------------------------------------
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(300.0f, 5.0f, 150.0f));
-		model = glm::scale(model, glm::vec3(8.0));
-		model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		mapa.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(posxs + 340.0f, poszs + 11.0f, posys)); //(340,10,0)
-		model = glm::scale(model, glm::vec3(3.0));
-		model = glm::rotate(model, glm::radians(rotsonic), glm::vec3(1.0f, 0.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		sonic.Draw(staticShader);
-
-		//Rings
-		// -------------------------------------------------------------------------------------------------------------------------
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(340.0f, 10.0f, 150.0f));
-		model = glm::scale(model, glm::vec3(4.0));
-		model = glm::rotate(model, glm::radians(rotring), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		ring.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(340.0f, 10.0f, 100.0f));
-		model = glm::scale(model, glm::vec3(4.0));
-		model = glm::rotate(model, glm::radians(rotring), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		ring.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(340.0f, 10.0f, 50.0f));
-		model = glm::scale(model, glm::vec3(4.0));
-		model = glm::rotate(model, glm::radians(rotring), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		ring.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(250.0f, 10.0f, 150.0f));
-		model = glm::scale(model, glm::vec3(4.0));
-		model = glm::rotate(model, glm::radians(rotring), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		ring.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(250.0f, 10.0f, 200.0f));
-		model = glm::scale(model, glm::vec3(4.0));
-		model = glm::rotate(model, glm::radians(rotring), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		ring.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(250.0f, 10.0f, 250.0f));
-		model = glm::scale(model, glm::vec3(4.0));
-		model = glm::rotate(model, glm::radians(rotring), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		ring.Draw(staticShader);
-
-		//Microfono
-		// -------------------------------------------------------------------------------------------------------------------------
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(100.0f, 7.5f, -110.0f));
-		model = glm::scale(model, glm::vec3(150.0));
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		micro.Draw(staticShader);
-
-		//Globos
-		// -------------------------------------------------------------------------------------------------------------------------
-		/*model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 25.0f, 40.0f));
-		model = glm::scale(model, glm::vec3(0.25));
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		globodec.Draw(staticShader);
-
-		model = glm::translate(glm::mat4(1.0f), glm::vec3(15.0f, 25.0f, 40.0f));
-		model = glm::scale(model, glm::vec3(0.25));
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		globor.Draw(staticShader);
-
-		model = glm::translate(glm::mat4(1.0f), glm::vec3(30.0f, 25.0f, 40.0f));
-		model = glm::scale(model, glm::vec3(0.25));
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		globon.Draw(staticShader);
-
-		model = glm::translate(glm::mat4(1.0f), glm::vec3(-15.0f, 25.0f, 40.0f));
-		model = glm::scale(model, glm::vec3(0.25));
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		globop.Draw(staticShader);*/
-
-		//Cocina
-		// -------------------------------------------------------------------------------------------------------------------------
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(-165.0f, 0.0f, 10.0f));
-		model = glm::scale(model, glm::vec3(13.0f));
-		model = glm::rotate(model, glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		cocina.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(-220.0f, 0.0f, 10.0f));
-		model = glm::scale(model, glm::vec3(13.0f));
-		model = glm::rotate(model, glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		cocina.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(-180.0f, 0.0f, -70.0f));
-		model = glm::scale(model, glm::vec3(6.0f));
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		mesa.Draw(staticShader);
-
-		//Mesa bar
-		// -------------------------------------------------------------------------------------------------------------------------
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(-55.0f, 0.0f, -10.0f));
-		model = glm::scale(model, glm::vec3(2.0f));
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		bar.Draw(staticShader);
-
-		//Cortinas Escenario
-		// -------------------------------------------------------------------------------------------------------------------------
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(123.0f, 7.0f, -115.0f));
-		model = glm::scale(model, glm::vec3(11.0f));
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		cortina.Draw(staticShader);
-
-		//Arcade
-		// -------------------------------------------------------------------------------------------------------------------------
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(180.0f, 0.0f, -10.0f));
-		model = glm::scale(model, glm::vec3(10.0f));
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		Arcade1.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(180.0f, 0.0f, 10.0f));
-		model = glm::scale(model, glm::vec3(10.0f));
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		Arcade1.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(140.0f, 0.0f, -35.0f));
-		model = glm::scale(model, glm::vec3(0.4f));
-		staticShader.setMat4("model", model);
-		Arcade2.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(160.0f, 0.0f, -35.0f));
-		model = glm::scale(model, glm::vec3(0.4f));
-		staticShader.setMat4("model", model);
-		Arcade2.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(140.0f, 0.0f, 33.0f));
-		model = glm::scale(model, glm::vec3(1.15f));
-		model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		Arcade3.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(160.0f, 0.0f, 33.0f));
-		model = glm::scale(model, glm::vec3(1.15f));
-		model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		Arcade3.Draw(staticShader);
-
-		//Freddy
-		// -------------------------------------------------------------------------------------------------------------------------
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(40.0f, 0.0f, 50.0f));
-		model = glm::scale(model, glm::vec3(10.0));
-		staticShader.setMat4("model", model);
-		Freddy.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(47.0f, 34.5f, 48.0f));
-		model = glm::scale(model, glm::vec3(10.0));
-		model = glm::rotate(model, glm::radians(rotBrazoF), glm::vec3(0.0f, 0.0f, 1.0f));
-		staticShader.setMat4("model", model);
-		FreddyBrazo.Draw(staticShader);
-
-		//Eggman
-		// -------------------------------------------------------------------------------------------------------------------------
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(eggx, eggz, eggy));
-		model = glm::scale(model, glm::vec3(3.0));
-		model = glm::rotate(model, glm::radians(rotegg), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		Eggman.Draw(staticShader);
-
-		//Chica
-		// -------------------------------------------------------------------------------------------------------------------------
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(0.0f, 0.0f, -220.0f));
-		model = glm::scale(model, glm::vec3(0.3));
-		staticShader.setMat4("model", model);
-		Chica.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(-4.5f, 17.0f, -218.5f));
-		model = glm::scale(model, glm::vec3(0.3));
-		model = glm::rotate(model, glm::radians(rotBrazoC), glm::vec3(1.0f, 0.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		ChicaBrazo.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(-4.5f, poszpanque, -212.0f));
-		model = glm::scale(model, glm::vec3(0.025));
-		model = glm::rotate(model, glm::radians(rotpanque), glm::vec3(1.0f, 0.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		panque.Draw(staticShader);
-
-		//cheff
-		// -------------------------------------------------------------------------------------------------------------------------
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(-180.0f, 0.0f, 0.0f));//(-180,0,0)
-		model = glm::scale(model, glm::vec3(14.0f));
-		staticShader.setMat4("model", model);
-		cheff.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(-182.0f, 13.5f, 0.0f));//(-180,0,0)
-		model = glm::scale(model, glm::vec3(14.0f));
-		model = glm::rotate(model, glm::radians(rotcheff), glm::vec3(0.0f, 0.0f, 1.0f));
-		model = glm::rotate(model, glm::radians(105.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		cheffbd.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(-178.0f, 13.5f, 0.0f));//(-180,0,0)
-		model = glm::scale(model, glm::vec3(14.0f));
-		model = glm::rotate(model, glm::radians(-1*rotcheff), glm::vec3(0.0f, 0.0f, 1.0f));
-		model = glm::rotate(model, glm::radians(75.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		cheffbd.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(-180.0f, poszsar, 7.0f));//(-180,13.5,0)
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		model = glm::rotate(model, glm::radians(rotsarten), glm::vec3(0.0f, 0.0f, 1.0f));
-		staticShader.setMat4("model", model);
-		sarten.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(-180.0f, 11.2f, -70.0f));
-		model = glm::scale(model, glm::vec3(2.0f));
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		plato.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(-180.0f, carnez + 13.5, carney));//(-180,13.5,12.0)
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		carne.Draw(staticShader);
-
-		//Bunny
-		// -------------------------------------------------------------------------------------------------------------------------
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(-85.0f, -0.5f, -10.0f));
-		model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		model = glm::scale(model, glm::vec3(7.0));
-		staticShader.setMat4("model", model);
-		Bunny.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(-85.0f, -0.5f, -10.0f));
-		model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		model = glm::scale(model, glm::vec3(7.0));
-		model = glm::rotate(model, glm::radians(rot_bIzqB), glm::vec3(1.0f, 0.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		BunnyBrazoIzq.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(-85.0f, -0.5f, -10.0f));
-		model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		model = glm::scale(model, glm::vec3(7.0));
-		model = glm::rotate(model, glm::radians(rot_bDerB), glm::vec3(1.0f, 0.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		BunnyBrazoDer.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(-85.0f, -0.5f, -10.0f));
-		model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		model = glm::scale(model, glm::vec3(7.0));
-		model = glm::rotate(model, glm::radians(rot_pIzqB), glm::vec3(1.0f, 0.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		BunnyPieIzq.Draw(staticShader);
-
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(-85.0f, -0.5f, -10.0f));
-		model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		model = glm::scale(model, glm::vec3(7.0));
-		model = glm::rotate(model, glm::radians(rot_pDerB), glm::vec3(1.0f, 0.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		BunnyPieDer.Draw(staticShader);
-
-		//Globo
-		// -------------------------------------------------------------------------------------------------------------------------
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(posX_globo + movGlobo_x, posy_globo + movGlobo_y, posz_globo));
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		model = glm::scale(model, glm::vec3(0.3));
-		model = glm::rotate(model, glm::radians(giroGlobo), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		globo.Draw(staticShader);
-
-		//Pasto Diorama
-		// -------------------------------------------------------------------------------------------------------------------------
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
-		}
-		else {
-			model = glm::mat4(1.0f);
-		}
-		model = glm::translate(model, glm::vec3(0.0f, -13.25f, 0.0f));
-		model = glm::scale(model, glm::vec3(50.0f));
-		staticShader.setMat4("model", model);
-		piso.Draw(staticShader);
 
+		// Escena: carga las regiones cercanas, interpola los objetos animados, descarta los que quedan fuera de la camara,
+		// elige el nivel de detalle segun su tamano en pantalla y dibuja cada grupo de la tabla
 		// -------------------------------------------------------------------------------------------------------------------------
-		// BallonBoy
-		// -------------------------------------------------------------------------------------------------------------------------
-		glm::mat4 pgbb = glm::mat4(1.0f); // BALLONBOY PIVOTE-GLOBO
-		glm::mat4 plbb = glm::mat4(1.0f); // BALLONBOY PIVOTE-LETRERO
-		glm::mat4 torsoTemp = glm::mat4(1.0f); //BALLONBOY-PIVOTE-TORSO
-		glm::mat4 phdbb = glm::mat4(1.0f); //BALLONBOY PIVOTE-HOMBRO-DERECHO
-		glm::mat4 phibb = glm::mat4(1.0f); // BALLONBOY PIVOTE-HOMBRO-IZQUIERDO
-		glm::mat4 pribb = glm::mat4(1.0f); // BALLONBOY PIVOTE-RODILLA-IZQUIERDA
-		glm::mat4 prdbb = glm::mat4(1.0f); // BALLONBOY PIVOTE-RODILLA-DERECHA
-
-		BBCameraX = 1.75f * glm::cos(glm::radians(camera.getYaw()));
-		BBCameraZ = 1.5f * glm::sin(glm::radians(camera.getYaw()));
-
-		//TORZO
-		
-		model = glm::translate(model, glm::vec3(100.0f, 15.0f, 100.0f));
-		model = glm::scale(model, glm::vec3(0.65f));
-		if (camera.getIsometric()) {
-			model = camera.ConfIsometric(model);
+		perfil.begin("Escena");
+		glm::mat4 raiz = camera.getIsometric() ? camera.ConfIsometric(glm::mat4(1.0f)) : glm::mat4(1.0f);
+		regiones.update(camera.Position, raiz);
+		cargador.poll();
+		escena.refresh();
+		escena.update(raiz, mezcla, &trabajos);
+		escena.prepare(trabajos, camera.getFrustum(projection), camera.Position, projection);
+		trabajos.run();
+		perfil.end();
+		for (unsigned int g = 0; g < escena.groupNames.size(); g++)
+		{
+			ProfileScope seccion(perfil, escena.groupNames[g].c_str());
+			escena.drawGroup(staticUniforms, g);
 		}
-		model = glm::translate(model, glm::vec3(camera.getPosition().x + BBCameraX, camera.getPosition().y, camera.getPosition().z) + BBCameraZ); //Intentar rolar con este
-		torsoTemp = model = glm::rotate(model, glm::radians(-camera.getYaw() + 90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		torsoBB.Draw(staticShader);
-		//CABEZA
-		model = glm::translate(torsoTemp, glm::vec3(0.0f, 10.5f, 1.5f)); //-1.8f
-		//model = glm::scale(model, glm::vec3(0.75f));
-		model = glm::rotate(model, glm::radians(movCabeza), glm::vec3(0.0f, 1.0f, 0.0f));
-		model = glm::translate(model, glm::vec3(0.0f, 10.5f, 1.5f));
-		staticShader.setMat4("model", model);
-		cabezaBB.Draw(staticShader);
-
-		//HOMBRO_DERECHO
-		model = glm::translate(torsoTemp, glm::vec3(3.0f, 4.0f, 0.0f));
-		//model = glm::scale(model, glm::vec3(0.75f));
-		model = glm::rotate(model, glm::radians(movHombroDer), glm::vec3(0.0f, 0.0f, 1.0f));
-		phdbb = model = glm::translate(model, glm::vec3(3.0f, 0.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		hombroDerBB.Draw(staticShader);
-
-		//BRAZO_DERECHO
-		model = glm::translate(phdbb, glm::vec3(6.0f, 0.0f, 0.0f));
-		//model = glm::scale(model, glm::vec3(0.75f));
-		plbb = model = glm::rotate(model, glm::radians(movBrazoDer), glm::vec3(0.0f, 0.0f, 1.0f));
-		model = glm::translate(model, glm::vec3(1.0f, 0.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		brazoDerBB.Draw(staticShader);
-
-		//HOMBRO_IZQUIERDO
-		model = glm::translate(torsoTemp, glm::vec3(-3.0f, 4.0f, 0.0f));
-		//model = glm::scale(model, glm::vec3(0.75f));
-		model = glm::rotate(model, glm::radians(-movHombroIzq), glm::vec3(0.0f, 0.0f, 1.0f));
-		phibb = model = glm::translate(model, glm::vec3(-3.0f, 0.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		hombroIzqBB.Draw(staticShader);
-
-		//BRAZO_IZQUIERDO
-		model = glm::translate(phibb, glm::vec3(-5.0f, 0.0f, 0.0f));
-		//model = glm::scale(model, glm::vec3(0.75f));
-		pgbb = model = glm::rotate(model, glm::radians(-movBrazIzq), glm::vec3(0.0f, 0.0f, 1.0f));
-		model = glm::translate(model, glm::vec3(-1.0f, 0.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		brazoIzqBB.Draw(staticShader);
-
-		//PIERNA DERECHA ARRIBA
-		model = glm::translate(torsoTemp, glm::vec3(5.0f, -7.0f, 0.0f)); //-1.8f
-		//model = glm::scale(model, glm::vec3(0.75f));
-		model = glm::rotate(model, glm::radians(movPierDer), glm::vec3(1.0f, 0.0f, 0.0f));
-		prdbb = model = glm::translate(model, glm::vec3(1.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		piernaDerArrBB.Draw(staticShader);
-
-		//PIERNA DERECHA ABAJO 
-		model = glm::translate(prdbb, glm::vec3(0.0f, -10.0f, -0.5f)); //-1.8f
-		//model = glm::scale(model, glm::vec3(0.75f));
-		model = glm::rotate(model, glm::radians(rotRodDer), glm::vec3(1.0f, 0.0f, 0.0f));
-		model = glm::translate(model, glm::vec3(0.0f, 2.0f, -0.5f));
-		staticShader.setMat4("model", model);
-		piernaDerAbBB.Draw(staticShader);
-
-		//PIERNA IZQUIERDA ARRIBA
-		model = glm::translate(torsoTemp, glm::vec3(-5.0f, -7.0f, 0.0f)); //-1.8f
-		//model = glm::scale(model, glm::vec3(0.75f));
-		model = glm::rotate(model, glm::radians(movPierIzq), glm::vec3(1.0f, 0.0f, 0.0f));
-		pribb = model = glm::translate(model, glm::vec3(-1.0f, 1.0f, 0.0f));
-		staticShader.setMat4("model", model);
-		piernaIzqArrBB.Draw(staticShader);
-
-		//PIERNA IZQUIERDA ABAJO
-		model = glm::translate(pribb, glm::vec3(0.0f, -10.0f, -0.5f)); //-1.8f
-		//model = glm::scale(model, glm::vec3(0.75f));
-		model = glm::rotate(model, glm::radians(rotRodIzq), glm::vec3(1.0f, 0.0f, 0.0f));
-		model = glm::translate(model, glm::vec3(0.0f, 2.0f, -0.5f));
-		staticShader.setMat4("model", model);
-		piernaDerAbBB.Draw(staticShader);
-
-		//GLOBO
-		model = glm::translate(pgbb, glm::vec3(-9.55f, 0.0f, -0.5f)); //-1.8f
-		model = glm::rotate(model, glm::radians(-movBrazIzq), glm::vec3(0.0f, 0.0f, 1.0f));
-		//model = glm::scale(model, glm::vec3(0.75f));
-		//model = glm::translate(model, glm::vec3(0.0f, 2.0f, -0.5f));
-		staticShader.setMat4("model", model);
-		globoBB.Draw(staticShader);
-		//LETRERO
-		model = glm::translate(plbb, glm::vec3(9.55f, 0.0f, -0.5f)); //-1.8f
-		model = glm::rotate(model, glm::radians(movBrazoDer), glm::vec3(0.0f, 0.0f, 1.0f));
-		//model = glm::translate(model, glm::vec3(0.0f, 2.0f, -0.5f));
-		//model = glm::scale(model, glm::vec3(0.75f));
-		staticShader.setMat4("model", model);
-		letreroBB.Draw(staticShader);
-
-
+		perfil.begin("Instancias");
+		escena.drawInstanced(instUniforms);
+		perfil.end();
 		
 		// -------------------------------------------------------------------------------------------------------------------------
 		// Termina Escenario
@@ -1810,27 +1293,54 @@ int main()
 		//-------------------------------------------------------------------------------------
 		// draw skybox as last
 		// -------------------
+		perfil.begin("Skybox");
 		skyboxShader.use();
 		skybox.Draw(skyboxShader, view, projection, camera);
+		perfil.end();
 
-		// Limitar el framerate a 60
-		deltaTime = SDL_GetTicks() - lastFrame; // time for full 1 loop
-		//std::cout <<"frame time = " << frameTime << " milli sec"<< std::endl;
-		if (deltaTime < LOOP_TIME)
-		{
-			SDL_Delay((int)(LOOP_TIME - deltaTime));
-		}
+		// Espera al siguiente cuadro cuando hay limite de cuadros por segundo
+		perfil.begin("Espera");
+		ritmo.wait();
+		perfil.end();
 
 		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
 		// -------------------------------------------------------------------------------
+		perfil.begin("SwapBuffers");
 		glfwSwapBuffers(window);
+		perfil.end();
+		perfil.endFrame();
+
+		//El benchmark espera a que el GPU termine el cuadro para medir CPU y GPU juntos
+		if (modoBenchmark)
+		{
+			glFinish();
+			medicion.frame((FramePacer::now() - ahora) * 1000.0, drawCounters().calls, drawCounters().triangles);
+			if (++cuadrosBenchmark >= pasosBenchmark)
+				glfwSetWindowShouldClose(window, true);
+		}
 		glfwPollEvents();
 	}
 
+	//Ademas del recorrido se miden las matrices de 16384 objetos con glm y con los kernels de transforms.h,
+	//si los kernels no dan las mismas matrices el programa termina con error
+	bool kernelsIguales = true;
+	if (modoBenchmark)
+	{
+		medicion.print(stdout);
+		kernelsIguales = benchmarkTransforms(stdout);
+	}
+
+	if (perfil.recording())
+		perfil.stop("captura.json");
+	perfil.Terminate();
 	skybox.Terminate();
+	escena.Terminate();
+	regiones.Terminate();
+	cargador.Terminate();
+	luces.Terminate();
 
 	glfwTerminate();
-	return 0;
+	return kernelsIguales ? 0 : 1;
 }
 
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
@@ -1862,14 +1372,10 @@ void my_input(GLFWwindow *window, int key, int scancode, int action, int mode)
 	{
 		if (reproduciranimacion < 1)
 		{
-			if (play == false && (FrameIndex > 1))
+			if (!animaciones.playing(clipGlobo) && animaciones.keys(clipGlobo, 0) > 1)
 			{
-				resetElements();
-				//First Interpolation				
-				interpolation();
-				play = true;
-				playIndex = 0;
-				i_curr_steps = 0;
+				animaciones.seek(clipGlobo, 0.0f);
+				animaciones.play(clipGlobo);
 				reproduciranimacion++;
 				printf("\n presiona 0 para habilitar reproducir de nuevo la animación'\n");
 				habilitaranimacion = 0;
@@ -1877,7 +1383,7 @@ void my_input(GLFWwindow *window, int key, int scancode, int action, int mode)
 			}
 			else
 			{
-				play = false;
+				animaciones.stop(clipGlobo);
 			}
 		}
 	}
@@ -1886,6 +1392,35 @@ void my_input(GLFWwindow *window, int key, int scancode, int action, int mode)
 		Freddyanim ^= true;
 	if (key == GLFW_KEY_2 && action == GLFW_PRESS)
 		Chicaanim ^= true;
+	//Copias de Freddy, Chica y Sonic, cada una a un lado de la anterior
+	if (key == GLFW_KEY_4 && action == GLFW_PRESS)
+		mundo.spawn(personajeFreddy, glm::vec3(-25.0f * ++copiasFreddy, 0.0f, 0.0f), escena);
+	if (key == GLFW_KEY_5 && action == GLFW_PRESS)
+		mundo.spawn(personajeChica, glm::vec3(25.0f * ++copiasChica, 0.0f, 0.0f), escena);
+	if (key == GLFW_KEY_6 && action == GLFW_PRESS)
+		mundo.spawn(personajeSonic, glm::vec3(-20.0f * ++copiasSonic, 0.0f, 0.0f), escena);
+
+	//Tiempo por cuadro de los ultimos cuadros
+	if (key == GLFW_KEY_F && action == GLFW_PRESS)
+	{
+		FrameStats datos = ritmo.stats();
+		printf("%u cuadros: promedio %.3f ms, desviacion %.3f ms, min %.3f ms, max %.3f ms, p99 %.3f ms\n",
+			datos.frames, datos.mean, datos.deviation, datos.min, datos.max, datos.p99);
+	}
+	//Alterna entre FPS cuadros por segundo y sin limite
+	if (key == GLFW_KEY_G && action == GLFW_PRESS)
+		ritmo.setRate(ritmo.rate() > 0.0 ? 0.0 : FPS);
+	//Captura de tiempos por seccion, se abre en chrome://tracing o ui.perfetto.dev
+	if (key == GLFW_KEY_C && action == GLFW_PRESS)
+	{
+		if (!perfil.recording())
+		{
+			perfil.start();
+			printf("Captura iniciada\n");
+		}
+		else if (perfil.stop("captura.json"))
+			printf("Captura guardada en captura.json\n");
+	}
 	/*if (key == GLFW_KEY_3 && action == GLFW_PRESS)
 		animacion ^= true;*/
 
@@ -1910,6 +1445,12 @@ void my_input(GLFWwindow *window, int key, int scancode, int action, int mode)
 			reinicioFrame = 0;
 		}
 	}
+	//Guarda los keyframes del globo para las siguientes ejecuciones
+	if (key == GLFW_KEY_O && action == GLFW_PRESS)
+	{
+		if (writeTake(RUTA_TAKE_GLOBO, animaciones, clipGlobo))
+			printf("Keyframes del globo guardados en %s\n", RUTA_TAKE_GLOBO);
+	}
 	if (key == GLFW_KEY_3 && action == GLFW_PRESS)
 	{
 		if (reinicioFrame < 1)
@@ -0,0 +1,236 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <glad/glad.h>
+
+#include <staticmodel.h>
+#include <meshcache.h>
+#include <texturecache.h>
+#include <threadpool.h>
+
+#include <cctype>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Absolute form of a path so that different spellings of one file share a key. Falls back to
+// the path as given when the file does not exist.
+inline std::string canonicalPath(const std::string &path)
+{
+#ifdef _WIN32
+	char full[_MAX_PATH];
+	if (_fullpath(full, path.c_str(), _MAX_PATH) == NULL)
+		return path;
+	std::string result(full);
+	for (unsigned int i = 0; i < result.size(); i++)
+		result[i] = result[i] == '\\' ? '/' : (char)std::tolower((unsigned char)result[i]);
+	return result;
+#else
+	char *full = realpath(path.c_str(), NULL);
+	if (full == NULL)
+		return path;
+	std::string result(full);
+	std::free(full);
+	return result;
+#endif
+}
+
+// Loads models and textures in the background and shares them by canonical path. Asking twice
+// for the same file returns the same model, and a texture used by several models is decoded and
+// uploaded once. Both are reference counted: release() drops a reference and frees the GPU
+// memory of the last one.
+//
+// A worker maps (or builds) the mesh cache of a model, then the GL thread creates its buffers
+// the next time it calls poll() or finish(). Texture names are created with the model and
+// filled once their own worker has decoded them. A model keeps its address for the lifetime of
+// the loader, even after it is released and loaded again.
+class AssetLoader
+{
+public:
+	explicit AssetLoader(unsigned int threads = 0) : pending(0), pool(threads)
+	{
+	}
+
+	// Returns the model of path, empty until its upload runs on the GL thread
+	StaticModel &model(const std::string &path)
+	{
+		ModelEntry *entry = &models[slot(path)];
+		if (entry->refs++ > 0 || entry->loading)
+			return entry->model;
+
+		entry->loading = true;
+		pending++;
+		pool.submit([this, entry, path]() {
+			std::shared_ptr<ModelData> data(new ModelData());
+			bool loaded = loadModelData(path, *data);
+			uploads.post([this, entry, path, data, loaded]() {
+				entry->loading = false;
+				pending--;
+				if (!loaded)
+					std::cout << "Failed to load model: " << path << std::endl;
+				else if (entry->refs > 0)
+					upload(*entry, *data);
+			});
+		});
+		return entry->model;
+	}
+
+	// Returns the model of path without loading it. It stays empty until someone calls model()
+	// for the same file, which fills this same object.
+	StaticModel &reserve(const std::string &path)
+	{
+		return models[slot(path)].model;
+	}
+
+	// Drops a reference to a model, the last one frees it and its share of the textures
+	void release(StaticModel &m)
+	{
+		for (unsigned int i = 0; i < models.size(); i++)
+		{
+			if (&models[i].model != &m || models[i].refs == 0)
+				continue;
+			if (--models[i].refs == 0)
+				unload(models[i]);
+			return;
+		}
+	}
+
+	bool ready(const StaticModel &m) const
+	{
+		return m.levels() > 0;
+	}
+
+	// Uploads the assets finished so far, call it from the GL thread
+	unsigned int poll()
+	{
+		return uploads.run();
+	}
+
+	// Blocks until every requested asset is uploaded
+	void finish()
+	{
+		while (pending > 0)
+		{
+			uploads.wait();
+			uploads.run();
+		}
+	}
+
+	unsigned int loading() const
+	{
+		return pending;
+	}
+
+	void Terminate()
+	{
+		finish();
+		for (unsigned int i = 0; i < models.size(); i++)
+			if (models[i].refs > 0)
+			{
+				models[i].refs = 0;
+				unload(models[i]);
+			}
+	}
+
+private:
+	struct ModelEntry
+	{
+		StaticModel model;
+		unsigned int refs;
+		bool loading;
+		std::vector<std::string> textures;	// Keys of the textures it holds a reference to
+
+		ModelEntry() : refs(0), loading(false)
+		{
+		}
+	};
+
+	struct TextureEntry
+	{
+		unsigned int id;
+		unsigned int refs;
+	};
+
+	std::deque<ModelEntry> models;
+	std::unordered_map<std::string, unsigned int> modelIndex;
+	std::unordered_map<std::string, TextureEntry> textures;
+	MainThreadQueue uploads;
+	unsigned int pending;	// Only touched on the GL thread
+	ThreadPool pool;		// Declared last so its workers stop before the rest is destroyed
+
+	// Finds the entry of a file or creates an empty one
+	unsigned int slot(const std::string &path)
+	{
+		std::string key = canonicalPath(path);
+		std::unordered_map<std::string, unsigned int>::iterator it = modelIndex.find(key);
+		if (it != modelIndex.end())
+			return it->second;
+		models.push_back(ModelEntry());
+		modelIndex[key] = (unsigned int)models.size() - 1;
+		return (unsigned int)models.size() - 1;
+	}
+
+	void upload(ModelEntry &entry, const ModelData &data)
+	{
+		std::vector<unsigned int> ids;
+		for (unsigned int t = 0; t < data.textures.size(); t++)
+		{
+			std::string key = canonicalPath(data.directory + '/' + data.textures[t].path);
+			ids.push_back(acquireTexture(key));
+			entry.textures.push_back(key);
+		}
+		entry.model.upload(data, ids);
+	}
+
+	void unload(ModelEntry &entry)
+	{
+		entry.model.Terminate();
+		for (unsigned int t = 0; t < entry.textures.size(); t++)
+			releaseTexture(entry.textures[t]);
+		entry.textures.clear();
+	}
+
+	unsigned int acquireTexture(const std::string &key)
+	{
+		std::unordered_map<std::string, TextureEntry>::iterator it = textures.find(key);
+		if (it != textures.end())
+		{
+			it->second.refs++;
+			return it->second.id;
+		}
+
+		TextureEntry entry;
+		glGenTextures(1, &entry.id);
+		entry.refs = 1;
+		textures[key] = entry;
+
+		unsigned int id = entry.id;
+		pending++;
+		pool.submit([this, key, id]() {
+			std::shared_ptr<TextureData> data(new TextureData());
+			loadTextureData(key, *data);
+			uploads.post([this, key, id, data]() {
+				pending--;
+				std::unordered_map<std::string, TextureEntry>::iterator it = textures.find(key);
+				if (it != textures.end() && it->second.id == id)
+					uploadTexture(id, *data);
+			});
+		});
+		return entry.id;
+	}
+
+	void releaseTexture(const std::string &key)
+	{
+		std::unordered_map<std::string, TextureEntry>::iterator it = textures.find(key);
+		if (it == textures.end() || --it->second.refs > 0)
+			return;
+		glDeleteTextures(1, &it->second.id);
+		textures.erase(it);
+	}
+};
+
+#endif
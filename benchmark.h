@@ -0,0 +1,270 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <camera.h>
+#include <transforms.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// A stretch of a camera tour: the camera turns from the yaw of the previous leg to this one while
+// it moves forward speed units every simulation step, for steps steps
+struct TourLeg
+{
+	float yaw;
+	float speed;
+	unsigned int steps;
+};
+
+// Scripted camera path driven one simulation step at a time through Camera::Recorrido and
+// Camera::MovimientoAutomatico. It never reads the clock, so step n always puts the camera in
+// the same place and two runs render the same frames.
+class CameraTour
+{
+public:
+	CameraTour(const glm::vec3 &start, float startYaw) : origin(start), originYaw(startYaw), leg(0), step(0)
+	{
+	}
+
+	void add(float yaw, float speed, unsigned int steps)
+	{
+		TourLeg tourLeg = { yaw, speed, steps };
+		legs.push_back(tourLeg);
+	}
+
+	// Simulation steps of the whole tour
+	unsigned int length() const
+	{
+		unsigned int total = 0;
+		for (unsigned int l = 0; l < legs.size(); l++)
+			total += legs[l].steps;
+		return total;
+	}
+
+	// Puts the camera at the start of the tour
+	void restart(Camera &camera)
+	{
+		leg = 0;
+		step = 0;
+		camera.Position = origin;
+		camera.Recorrido(originYaw);
+	}
+
+	// Moves the camera one simulation step along the tour, starting over after the last leg
+	void advance(Camera &camera)
+	{
+		if (legs.empty())
+			return;
+		if (leg >= legs.size())
+			restart(camera);
+		while (legs[leg].steps == 0)
+			if (++leg == legs.size())
+				return restart(camera);
+
+		const TourLeg &current = legs[leg];
+		float from = leg > 0 ? legs[leg - 1].yaw : originYaw;
+		float t = (float)(step + 1) / current.steps;
+		camera.Recorrido(from + (current.yaw - from) * t);
+		camera.MovimientoAutomatico(current.speed);
+		if (++step == current.steps)
+		{
+			step = 0;
+			leg++;
+		}
+	}
+
+private:
+	std::vector<TourLeg> legs;
+	glm::vec3 origin;
+	float originYaw;
+	unsigned int leg;
+	unsigned int step;
+};
+
+// Results of a benchmark run, times in milliseconds
+struct BenchmarkReport
+{
+	unsigned int frames;
+	double min;
+	double mean;
+	double p95;
+	double p99;
+	double max;
+	double drawCalls;		// Mean per frame
+	double triangles;		// Mean per frame
+	unsigned int maxDrawCalls;
+};
+
+// Keeps the time and the draw calls of every frame of a benchmark run. The first warmup frames
+// are left out of the report, they carry shader compilation and first uploads.
+class BenchmarkRecorder
+{
+public:
+	unsigned int warmup;
+
+	explicit BenchmarkRecorder(unsigned int warmupFrames = 30) : warmup(warmupFrames), seen(0)
+	{
+	}
+
+	void reserve(unsigned int frames)
+	{
+		times.reserve(frames);
+		calls.reserve(frames);
+		triangles.reserve(frames);
+	}
+
+	void frame(double milliseconds, unsigned int drawCalls, unsigned long long drawnTriangles)
+	{
+		if (seen++ < warmup)
+			return;
+		times.push_back(milliseconds);
+		calls.push_back(drawCalls);
+		triangles.push_back(drawnTriangles);
+	}
+
+	BenchmarkReport report() const
+	{
+		BenchmarkReport result = { 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0 };
+		if (times.empty())
+			return result;
+		std::vector<double> sorted(times);
+		std::sort(sorted.begin(), sorted.end());
+		result.frames = (unsigned int)sorted.size();
+		result.min = sorted.front();
+		result.max = sorted.back();
+		result.p95 = percentile(sorted, 0.95);
+		result.p99 = percentile(sorted, 0.99);
+		for (unsigned int i = 0; i < times.size(); i++)
+		{
+			result.mean += times[i];
+			result.drawCalls += calls[i];
+			result.triangles += (double)triangles[i];
+			result.maxDrawCalls = std::max(result.maxDrawCalls, calls[i]);
+		}
+		result.mean /= times.size();
+		result.drawCalls /= times.size();
+		result.triangles /= times.size();
+		return result;
+	}
+
+	// Prints the report for people and one key=value line for scripts comparing runs
+	void print(FILE *file) const
+	{
+		BenchmarkReport r = report();
+		std::fprintf(file, "Benchmark: %u frames (%u warmup frames left out)\n", r.frames, std::min(seen, warmup));
+		std::fprintf(file, "  frame time ms  min %.3f  avg %.3f  p95 %.3f  p99 %.3f  max %.3f\n", r.min, r.mean, r.p95, r.p99, r.max);
+		std::fprintf(file, "  draw calls     avg %.1f  max %u\n", r.drawCalls, r.maxDrawCalls);
+		std::fprintf(file, "  triangles      avg %.0f\n", r.triangles);
+		std::fprintf(file, "BENCHMARK frames=%u min=%.3f avg=%.3f p95=%.3f p99=%.3f max=%.3f draws=%.1f triangles=%.0f\n",
+			r.frames, r.min, r.mean, r.p95, r.p99, r.max, r.drawCalls, r.triangles);
+	}
+
+private:
+	std::vector<double> times;
+	std::vector<unsigned int> calls;
+	std::vector<unsigned long long> triangles;
+	unsigned int seen;
+
+	// Nearest rank percentile of sorted values
+	static double percentile(const std::vector<double> &sorted, double p)
+	{
+		unsigned int rank = (unsigned int)(p * sorted.size() + 0.999999);
+		if (rank < 1)
+			rank = 1;
+		return sorted[std::min(rank, (unsigned int)sorted.size()) - 1];
+	}
+};
+
+// Largest difference between two sets of matrices, relative to the size of each element when it
+// is larger than 1
+inline float matrixDifference(const std::vector<glm::mat4> &a, const std::vector<glm::mat4> &b)
+{
+	float worst = 0.0f;
+	for (unsigned int i = 0; i < a.size(); i++)
+		for (int c = 0; c < 4; c++)
+			for (int r = 0; r < 4; r++)
+				worst = std::max(worst, std::abs(a[i][c][r] - b[i][c][r]) / std::max(1.0f, std::abs(a[i][c][r])));
+	return worst;
+}
+
+// Microbenchmark of the transform kernels of transforms.h over count objects, in chains of four
+// like the parts of a character under a root carrying the isometric turn. Every round builds the
+// local matrices from position, rotation and scale and chains them to their parents three ways:
+// with the glm calls the scene used to make (translate * mat4_cast * scale and full products),
+// with the scalar kernels, and with the batched SSE ones. Prints the milliseconds per round of
+// each and how far their matrices are apart; returns false when they disagree beyond rounding.
+inline bool benchmarkTransforms(FILE *file, unsigned int count = 16384, unsigned int rounds = 50)
+{
+	std::vector<glm::vec3> position(count), scale(count);
+	std::vector<glm::quat> rotation(count);
+	std::vector<int> parent(count);
+	std::vector<unsigned int> index(count);
+	unsigned int seed = 12345;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		float v[7];
+		for (int k = 0; k < 7; k++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			v[k] = (seed >> 8) / 16777216.0f;
+		}
+		position[i] = glm::vec3(v[0] - 0.5f, v[1] - 0.5f, v[2] - 0.5f) * (i % 4 == 0 ? 400.0f : 10.0f);
+		rotation[i] = glm::angleAxis(v[3] * 6.2831853f, glm::normalize(glm::vec3(v[4] - 0.5f, v[5], v[6] - 0.5f) + glm::vec3(0.0f, 0.1f, 0.0f)));
+		scale[i] = glm::vec3(0.5f + v[6] * 2.0f);
+		parent[i] = i % 4 == 0 ? -1 : (int)i - 1;
+		index[i] = i;
+	}
+	glm::mat4 root = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -5.0f, 0.0f)), glm::radians(45.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	std::vector<glm::mat4> local(count), reference(count), scalar(count), batched(count);
+	double glmTime = 0.0, scalarTime = 0.0, batchedTime = 0.0;
+	for (unsigned int round = 0; round < rounds; round++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (unsigned int i = 0; i < count; i++)
+		{
+			glm::mat4 m = glm::translate(glm::mat4(1.0f), position[i]);
+			m = m * glm::mat4_cast(rotation[i]);
+			m = glm::scale(m, scale[i]);
+			reference[i] = (parent[i] < 0 ? root : reference[parent[i]]) * m;
+		}
+		std::chrono::steady_clock::time_point glmEnd = std::chrono::steady_clock::now();
+		for (unsigned int i = 0; i < count; i++)
+		{
+			composeTRS(position[i], rotation[i], scale[i], local[i]);
+			multiplyAffine(parent[i] < 0 ? root : scalar[parent[i]], local[i], scalar[i]);
+		}
+		std::chrono::steady_clock::time_point scalarEnd = std::chrono::steady_clock::now();
+		composeTRS(&position[0], &rotation[0], &scale[0], &index[0], count, &local[0]);
+		multiplyChain(&parent[0], root, &local[0], &index[0], count, &batched[0]);
+		std::chrono::steady_clock::time_point batchedEnd = std::chrono::steady_clock::now();
+
+		glmTime += std::chrono::duration<double, std::milli>(glmEnd - start).count();
+		scalarTime += std::chrono::duration<double, std::milli>(scalarEnd - glmEnd).count();
+		batchedTime += std::chrono::duration<double, std::milli>(batchedEnd - scalarEnd).count();
+	}
+
+	float scalarError = matrixDifference(reference, scalar);
+	float batchedError = matrixDifference(scalar, batched);
+	bool ok = scalarError < 1.0e-4f && batchedError < 1.0e-5f;
+#ifdef TRANSFORMS_SSE
+	const char *kernel = "SSE";
+#else
+	const char *kernel = "scalar";
+#endif
+	std::fprintf(file, "Transforms: %u objects, %u rounds, batched kernels %s\n", count, rounds, kernel);
+	std::fprintf(file, "  ms per round   glm %.3f  scalar %.3f  batched %.3f  (%.2fx over glm)\n",
+		glmTime / rounds, scalarTime / rounds, batchedTime / rounds, batchedTime > 0.0 ? glmTime / batchedTime : 0.0);
+	std::fprintf(file, "  difference     scalar vs glm %.2g  batched vs scalar %.2g  %s\n", scalarError, batchedError, ok ? "ok" : "MISMATCH");
+	std::fprintf(file, "TRANSFORMS objects=%u glm=%.3f scalar=%.3f batched=%.3f ok=%d\n",
+		count, glmTime / rounds, scalarTime / rounds, batchedTime / rounds, ok ? 1 : 0);
+	return ok;
+}
+
+#endif
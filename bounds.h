@@ -0,0 +1,41 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <glm/glm.hpp>
+
+#include <mesh.h>
+
+// Bounding volumes of a model in its own space
+struct Bounds
+{
+	glm::vec3 min;
+	glm::vec3 max;
+	glm::vec3 center;	// Center of the box, also used as the center of the sphere
+	float radius;		// Distance from center to the farthest vertex
+};
+
+// Computes the box and sphere enclosing the given vertices
+inline Bounds computeBounds(const Vertex *vertices, unsigned int count)
+{
+	Bounds bounds;
+	bounds.min = glm::vec3(0.0f);
+	bounds.max = glm::vec3(0.0f);
+	bounds.center = glm::vec3(0.0f);
+	bounds.radius = 0.0f;
+	if (count == 0)
+		return bounds;
+
+	bounds.min = bounds.max = vertices[0].Position;
+	for (unsigned int v = 1; v < count; v++)
+	{
+		bounds.min = glm::min(bounds.min, vertices[v].Position);
+		bounds.max = glm::max(bounds.max, vertices[v].Position);
+	}
+
+	bounds.center = (bounds.min + bounds.max) * 0.5f;
+	for (unsigned int v = 0; v < count; v++)
+		bounds.radius = glm::max(bounds.radius, glm::length(vertices[v].Position - bounds.center));
+	return bounds;
+}
+
+#endif
@@ -0,0 +1,336 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+
+#include <camera.h>
+#include <culling.h>
+
+#include <algorithm>
+#include <vector>
+
+// Maximum number of items stored in a leaf, one SSE batch of the frustum test
+const unsigned int BVH_LEAF_SIZE = 4;
+
+// Bounding volume hierarchy over a set of scene entries. Nodes live in one array with parents
+// before their children, so refit() is a single backwards pass. Leaves copy the boxes of their
+// items in leaf order, so a leaf is tested against the frustum in one SIMD batch.
+class BVH
+{
+public:
+	struct Node
+	{
+		glm::vec3 min;
+		unsigned int first;	// First child for inner nodes, first item for leaves
+		glm::vec3 max;
+		unsigned int count;	// Number of items, 0 for inner nodes
+	};
+
+	std::vector<Node> nodes;
+	std::vector<int> items;	// Scene entries in leaf order
+	BoxArrays boxes;		// Boxes of items, same order
+
+	bool empty() const
+	{
+		return items.empty();
+	}
+
+	// Builds the tree over the given entries using their current world boxes
+	void build(const std::vector<int> &entries, const BoxArrays &source)
+	{
+		items = entries;
+		nodes.clear();
+		boxes = BoxArrays();
+		if (items.empty())
+			return;
+
+		nodes.reserve(items.size() * 2);
+		nodes.push_back(Node());
+		split(0, 0, (unsigned int)items.size(), source);
+
+		for (unsigned int i = 0; i < items.size(); i++)
+		{
+			boxes.push();
+			copyBox(i, source);
+		}
+	}
+
+	// Builds again over the same items, for when they moved too much for a refit
+	void rebuild(const BoxArrays &source)
+	{
+		std::vector<int> entries;
+		entries.swap(items);
+		build(entries, source);
+	}
+
+	// Refreshes the item boxes and the node bounds without changing the topology
+	void refit(const BoxArrays &source)
+	{
+		for (unsigned int i = 0; i < items.size(); i++)
+			copyBox(i, source);
+
+		for (int n = (int)nodes.size() - 1; n >= 0; n--)
+		{
+			Node &node = nodes[n];
+			if (node.count > 0)
+				leafBounds(node);
+			else
+			{
+				node.min = glm::min(nodes[node.first].min, nodes[node.first + 1].min);
+				node.max = glm::max(nodes[node.first].max, nodes[node.first + 1].max);
+			}
+		}
+	}
+
+	// Sets visible[entry] to 1 for every item that touches the frustum
+	void cull(const Frustum &frustum, unsigned char *visible) const
+	{
+		if (nodes.empty())
+			return;
+		unsigned char result[BVH_LEAF_SIZE];
+		unsigned int stack[64];
+		unsigned int top = 0;
+		stack[top++] = 0;
+		while (top > 0)
+		{
+			const Node &node = nodes[stack[--top]];
+			int side = classify(frustum, node);
+			if (side < 0)
+				continue;
+			if (side > 0)
+			{
+				markSubtree(node, visible);
+				continue;
+			}
+			if (node.count > 0)
+			{
+				cullBoxes(frustum, boxes, node.first, node.count, result);
+				for (unsigned int i = 0; i < node.count; i++)
+					if (result[i])
+						visible[items[node.first + i]] = 1;
+				continue;
+			}
+			stack[top++] = node.first;
+			stack[top++] = node.first + 1;
+		}
+	}
+
+	// Appends the entries whose box overlaps the box [min, max]
+	void queryBox(const glm::vec3 &min, const glm::vec3 &max, std::vector<int> &out) const
+	{
+		if (nodes.empty())
+			return;
+		unsigned int stack[64];
+		unsigned int top = 0;
+		stack[top++] = 0;
+		while (top > 0)
+		{
+			const Node &node = nodes[stack[--top]];
+			if (!overlaps(node.min, node.max, min, max))
+				continue;
+			if (node.count > 0)
+			{
+				for (unsigned int i = node.first; i < node.first + node.count; i++)
+				{
+					glm::vec3 c(boxes.cx[i], boxes.cy[i], boxes.cz[i]);
+					glm::vec3 e(boxes.ex[i], boxes.ey[i], boxes.ez[i]);
+					if (overlaps(c - e, c + e, min, max))
+						out.push_back(items[i]);
+				}
+				continue;
+			}
+			stack[top++] = node.first;
+			stack[top++] = node.first + 1;
+		}
+	}
+
+	// Appends the entries whose box is within radius of center
+	void querySphere(const glm::vec3 &center, float radius, std::vector<int> &out) const
+	{
+		if (nodes.empty())
+			return;
+		unsigned int stack[64];
+		unsigned int top = 0;
+		stack[top++] = 0;
+		while (top > 0)
+		{
+			const Node &node = nodes[stack[--top]];
+			if (boxDistance2(node.min, node.max, center) > radius * radius)
+				continue;
+			if (node.count > 0)
+			{
+				for (unsigned int i = node.first; i < node.first + node.count; i++)
+				{
+					glm::vec3 c(boxes.cx[i], boxes.cy[i], boxes.cz[i]);
+					glm::vec3 e(boxes.ex[i], boxes.ey[i], boxes.ez[i]);
+					if (boxDistance2(c - e, c + e, center) <= radius * radius)
+						out.push_back(items[i]);
+				}
+				continue;
+			}
+			stack[top++] = node.first;
+			stack[top++] = node.first + 1;
+		}
+	}
+
+	// Returns the entry whose box the ray hits first (or -1), distance receives the hit distance.
+	// Only hits closer than the incoming distance are accepted.
+	int raycast(const glm::vec3 &origin, const glm::vec3 &direction, float &distance) const
+	{
+		int hit = -1;
+		if (nodes.empty())
+			return hit;
+		glm::vec3 inv(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+		unsigned int stack[64];
+		unsigned int top = 0;
+		stack[top++] = 0;
+		while (top > 0)
+		{
+			const Node &node = nodes[stack[--top]];
+			float t;
+			if (!rayBox(origin, inv, node.min, node.max, t) || t > distance)
+				continue;
+			if (node.count > 0)
+			{
+				for (unsigned int i = node.first; i < node.first + node.count; i++)
+				{
+					glm::vec3 c(boxes.cx[i], boxes.cy[i], boxes.cz[i]);
+					glm::vec3 e(boxes.ex[i], boxes.ey[i], boxes.ez[i]);
+					if (rayBox(origin, inv, c - e, c + e, t) && t < distance)
+					{
+						distance = t;
+						hit = items[i];
+					}
+				}
+				continue;
+			}
+			stack[top++] = node.first;
+			stack[top++] = node.first + 1;
+		}
+		return hit;
+	}
+
+private:
+	void copyBox(unsigned int i, const BoxArrays &source)
+	{
+		int e = items[i];
+		boxes.cx[i] = source.cx[e]; boxes.cy[i] = source.cy[e]; boxes.cz[i] = source.cz[e];
+		boxes.ex[i] = source.ex[e]; boxes.ey[i] = source.ey[e]; boxes.ez[i] = source.ez[e];
+	}
+
+	void leafBounds(Node &node) const
+	{
+		for (unsigned int i = node.first; i < node.first + node.count; i++)
+		{
+			glm::vec3 c(boxes.cx[i], boxes.cy[i], boxes.cz[i]);
+			glm::vec3 e(boxes.ex[i], boxes.ey[i], boxes.ez[i]);
+			if (i == node.first) {
+				node.min = c - e;
+				node.max = c + e;
+			}
+			node.min = glm::min(node.min, c - e);
+			node.max = glm::max(node.max, c + e);
+		}
+	}
+
+	// Splits items [first, first + count) at the median of the longest centroid axis
+	void split(unsigned int index, unsigned int first, unsigned int count, const BoxArrays &source)
+	{
+		glm::vec3 cmin(source.cx[items[first]], source.cy[items[first]], source.cz[items[first]]);
+		glm::vec3 cmax = cmin, bmin, bmax;
+		for (unsigned int i = first; i < first + count; i++)
+		{
+			int e = items[i];
+			glm::vec3 c(source.cx[e], source.cy[e], source.cz[e]);
+			glm::vec3 x(source.ex[e], source.ey[e], source.ez[e]);
+			if (i == first) {
+				bmin = c - x;
+				bmax = c + x;
+			}
+			bmin = glm::min(bmin, c - x);
+			bmax = glm::max(bmax, c + x);
+			cmin = glm::min(cmin, c);
+			cmax = glm::max(cmax, c);
+		}
+		nodes[index].min = bmin;
+		nodes[index].max = bmax;
+
+		if (count <= BVH_LEAF_SIZE)
+		{
+			nodes[index].first = first;
+			nodes[index].count = count;
+			return;
+		}
+
+		glm::vec3 size = cmax - cmin;
+		const std::vector<float> &axis = size.x >= size.y && size.x >= size.z ? source.cx : (size.y >= size.z ? source.cy : source.cz);
+		unsigned int half = count / 2;
+		std::nth_element(items.begin() + first, items.begin() + first + half, items.begin() + first + count,
+			[&axis](int a, int b) { return axis[a] < axis[b]; });
+
+		unsigned int left = (unsigned int)nodes.size();
+		nodes[index].first = left;
+		nodes[index].count = 0;
+		nodes.push_back(Node());
+		nodes.push_back(Node());
+		split(left, first, half, source);
+		split(left + 1, first + half, count - half, source);
+	}
+
+	void markSubtree(const Node &root, unsigned char *visible) const
+	{
+		if (root.count > 0)
+		{
+			for (unsigned int i = root.first; i < root.first + root.count; i++)
+				visible[items[i]] = 1;
+			return;
+		}
+		markSubtree(nodes[root.first], visible);
+		markSubtree(nodes[root.first + 1], visible);
+	}
+
+	// -1 outside, 1 completely inside, 0 crossing a plane
+	static int classify(const Frustum &frustum, const Node &node)
+	{
+		glm::vec3 c = (node.min + node.max) * 0.5f;
+		glm::vec3 e = (node.max - node.min) * 0.5f;
+		int result = 1;
+		for (int p = 0; p < 6; p++)
+		{
+			const glm::vec4 &plane = frustum.planes[p];
+			float d = plane.x * c.x + plane.y * c.y + plane.z * c.z + plane.w;
+			float r = glm::abs(plane.x) * e.x + glm::abs(plane.y) * e.y + glm::abs(plane.z) * e.z;
+			if (d + r < 0.0f)
+				return -1;
+			if (d - r < 0.0f)
+				result = 0;
+		}
+		return result;
+	}
+
+	static bool overlaps(const glm::vec3 &amin, const glm::vec3 &amax, const glm::vec3 &bmin, const glm::vec3 &bmax)
+	{
+		return amin.x <= bmax.x && amax.x >= bmin.x && amin.y <= bmax.y && amax.y >= bmin.y && amin.z <= bmax.z && amax.z >= bmin.z;
+	}
+
+	static float boxDistance2(const glm::vec3 &min, const glm::vec3 &max, const glm::vec3 &p)
+	{
+		glm::vec3 d = glm::max(glm::max(min - p, p - max), glm::vec3(0.0f));
+		return glm::dot(d, d);
+	}
+
+	// Slab test, t receives the entry distance (0 when the origin is inside)
+	static bool rayBox(const glm::vec3 &origin, const glm::vec3 &inv, const glm::vec3 &min, const glm::vec3 &max, float &t)
+	{
+		glm::vec3 t0 = (min - origin) * inv;
+		glm::vec3 t1 = (max - origin) * inv;
+		glm::vec3 tmin = glm::min(t0, t1);
+		glm::vec3 tmax = glm::max(t0, t1);
+		float enter = glm::max(glm::max(tmin.x, tmin.y), glm::max(tmin.z, 0.0f));
+		float exit = glm::min(glm::min(tmax.x, tmax.y), tmax.z);
+		t = enter;
+		return enter <= exit;
+	}
+};
+
+#endif
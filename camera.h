@@ -15,6 +15,12 @@ enum Camera_Movement {
     RIGHT
 };
 
+// Planes of a view volume as (normal, distance), normals point inside and are normalized.
+// Order: left, right, bottom, top, near, far
+struct Frustum {
+    glm::vec4 planes[6];
+};
+
 // Default camera values
 const float YAW         = -90.0f;
 const float PITCH       =  0.0f;
@@ -77,6 +83,27 @@ public:
 		}
 	}
 
+	// Extracts the frustum planes in world space from the view matrix and the projection in use (perspective or ortho)
+	Frustum getFrustum(const glm::mat4 &projection)
+	{
+		glm::mat4 m = projection * GetViewMatrix();
+		glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+		glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+		glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+		glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+		Frustum frustum;
+		frustum.planes[0] = row3 + row0;
+		frustum.planes[1] = row3 - row0;
+		frustum.planes[2] = row3 + row1;
+		frustum.planes[3] = row3 - row1;
+		frustum.planes[4] = row3 + row2;
+		frustum.planes[5] = row3 - row2;
+		for (int i = 0; i < 6; i++)
+			frustum.planes[i] = frustum.planes[i] / glm::length(glm::vec3(frustum.planes[i]));
+		return frustum;
+	}
+
 	void Recorrido(float xoffset) {
 		Yaw = xoffset;
 		updateCameraVectors();
@@ -0,0 +1,98 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include <glm/glm.hpp>
+
+#include <camera.h>
+#include <bounds.h>
+
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define CULLING_SSE 1
+#include <xmmintrin.h>
+#endif
+
+// World space boxes stored as center/half extent arrays so four of them are tested per SSE instruction
+struct BoxArrays
+{
+	std::vector<float> cx, cy, cz;
+	std::vector<float> ex, ey, ez;
+
+	void push()
+	{
+		cx.push_back(0.0f); cy.push_back(0.0f); cz.push_back(0.0f);
+		ex.push_back(0.0f); ey.push_back(0.0f); ez.push_back(0.0f);
+	}
+
+	// Stores the world box of a local box placed by matrix (center transformed, extents by |M|)
+	void set(unsigned int i, const Bounds &bounds, const glm::mat4 &matrix)
+	{
+		glm::vec3 extent = (bounds.max - bounds.min) * 0.5f;
+		glm::vec4 center = matrix * glm::vec4(bounds.center, 1.0f);
+		cx[i] = center.x; cy[i] = center.y; cz[i] = center.z;
+		ex[i] = glm::abs(matrix[0][0]) * extent.x + glm::abs(matrix[1][0]) * extent.y + glm::abs(matrix[2][0]) * extent.z;
+		ey[i] = glm::abs(matrix[0][1]) * extent.x + glm::abs(matrix[1][1]) * extent.y + glm::abs(matrix[2][1]) * extent.z;
+		ez[i] = glm::abs(matrix[0][2]) * extent.x + glm::abs(matrix[1][2]) * extent.y + glm::abs(matrix[2][2]) * extent.z;
+	}
+
+	unsigned int size() const
+	{
+		return (unsigned int)cx.size();
+	}
+};
+
+// A box is outside when it lies completely behind any plane: n.c + w + |n|.e < 0
+inline bool boxInFrustum(const Frustum &frustum, float cx, float cy, float cz, float ex, float ey, float ez)
+{
+	for (int p = 0; p < 6; p++)
+	{
+		const glm::vec4 &plane = frustum.planes[p];
+		float d = plane.x * cx + plane.y * cy + plane.z * cz + plane.w;
+		float r = glm::abs(plane.x) * ex + glm::abs(plane.y) * ey + glm::abs(plane.z) * ez;
+		if (d + r < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+// Tests boxes [first, first + count) and writes 1 in visible[i - first] for every box that touches
+// the frustum and 0 for the rest
+inline void cullBoxes(const Frustum &frustum, const BoxArrays &boxes, unsigned int first, unsigned int count, unsigned char *visible)
+{
+	unsigned int end = first + count;
+	unsigned int i = first;
+#ifdef CULLING_SSE
+	__m128 nx[6], ny[6], nz[6], nw[6], ax[6], ay[6], az[6];
+	for (int p = 0; p < 6; p++)
+	{
+		const glm::vec4 &plane = frustum.planes[p];
+		nx[p] = _mm_set1_ps(plane.x); ax[p] = _mm_set1_ps(glm::abs(plane.x));
+		ny[p] = _mm_set1_ps(plane.y); ay[p] = _mm_set1_ps(glm::abs(plane.y));
+		nz[p] = _mm_set1_ps(plane.z); az[p] = _mm_set1_ps(glm::abs(plane.z));
+		nw[p] = _mm_set1_ps(plane.w);
+	}
+	const __m128 zero = _mm_setzero_ps();
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 cx = _mm_loadu_ps(&boxes.cx[i]), cy = _mm_loadu_ps(&boxes.cy[i]), cz = _mm_loadu_ps(&boxes.cz[i]);
+		__m128 ex = _mm_loadu_ps(&boxes.ex[i]), ey = _mm_loadu_ps(&boxes.ey[i]), ez = _mm_loadu_ps(&boxes.ez[i]);
+		__m128 outside = zero;
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)), _mm_add_ps(_mm_mul_ps(nz[p], cz), nw[p]));
+			__m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)), _mm_mul_ps(az[p], ez));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, r), zero));
+		}
+		int mask = _mm_movemask_ps(outside);
+		visible[i - first] = (mask & 1) == 0;
+		visible[i - first + 1] = (mask & 2) == 0;
+		visible[i - first + 2] = (mask & 4) == 0;
+		visible[i - first + 3] = (mask & 8) == 0;
+	}
+#endif
+	for (; i < end; i++)
+		visible[i - first] = boxInFrustum(frustum, boxes.cx[i], boxes.cy[i], boxes.cz[i], boxes.ex[i], boxes.ey[i], boxes.ez[i]);
+}
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef CURVES_H
+#define CURVES_H
+
+#include <cmath>
+#include <vector>
+
+// Channels of an animation sampled at a fixed rate and kept in a table, so the state of an
+// incremental animation at any time is read in O(1) instead of stepping to it from the start.
+// The table is an intro that plays once followed by a loop that repeats forever; a curve without
+// a loop holds its last sample. Between samples values are interpolated linearly, channels marked
+// as angles (in degrees) along the short way around.
+// Sampling does not touch the curve, any number of threads may sample it at once.
+class BakedCurve
+{
+public:
+	explicit BakedCurve(unsigned int channels = 1, double samplesPerSecond = 60.0) : channelCount(channels), rate(samplesPerSecond), loopStart(0), looping(false), angle(channels, 0)
+	{
+	}
+
+	void setAngle(unsigned int channel)
+	{
+		angle[channel] = 1;
+	}
+
+	// Appends the values of every channel at the next sample
+	void add(const float *values)
+	{
+		table.insert(table.end(), values, values + channelCount);
+	}
+
+	// The samples added from now on form the loop
+	void beginLoop()
+	{
+		loopStart = samples();
+		looping = true;
+	}
+
+	unsigned int channels() const
+	{
+		return channelCount;
+	}
+
+	unsigned int samples() const
+	{
+		return channelCount > 0 ? (unsigned int)(table.size() / channelCount) : 0;
+	}
+
+	bool loops() const
+	{
+		return looping && samples() > loopStart;
+	}
+
+	// Seconds before the loop starts, or up to the last sample without a loop
+	double introDuration() const
+	{
+		if (loops())
+			return loopStart / rate;
+		return samples() > 0 ? (samples() - 1) / rate : 0.0;
+	}
+
+	double loopDuration() const
+	{
+		return loops() ? (samples() - loopStart) / rate : 0.0;
+	}
+
+	// Values of every channel at time seconds from the first sample
+	void sample(double time, float *out) const
+	{
+		unsigned int count = samples();
+		if (count == 0)
+			return;
+		double position = time > 0.0 ? time * rate : 0.0;
+		unsigned int first, second;
+		double fraction;
+		if (loops() && position >= loopStart)
+		{
+			double cycle = std::fmod(position - loopStart, (double)(count - loopStart));
+			first = loopStart + (unsigned int)cycle;
+			if (first >= count)
+				first = count - 1;
+			second = first + 1 < count ? first + 1 : loopStart;
+			fraction = cycle - std::floor(cycle);
+		}
+		else if (position >= count - 1)
+		{
+			first = second = count - 1;
+			fraction = 0.0;
+		}
+		else
+		{
+			first = (unsigned int)position;
+			second = first + 1;
+			fraction = position - first;
+		}
+
+		const float *a = &table[first * channelCount];
+		const float *b = &table[second * channelCount];
+		float t = (float)fraction;
+		for (unsigned int c = 0; c < channelCount; c++)
+		{
+			float delta = b[c] - a[c];
+			if (angle[c])
+				delta -= 360.0f * std::floor(delta / 360.0f + 0.5f);
+			out[c] = a[c] + delta * t;
+		}
+	}
+
+private:
+	unsigned int channelCount;
+	double rate;
+	unsigned int loopStart;		// First sample of the loop
+	bool looping;
+	std::vector<float> table;	// Sample after sample, the channels of a sample together
+	std::vector<unsigned char> angle;
+};
+
+#endif
@@ -0,0 +1,358 @@
+#ifndef ENTITIES_H
+#define ENTITIES_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <curves.h>
+#include <jobs.h>
+#include <scene.h>
+
+#include <cmath>
+#include <vector>
+
+typedef unsigned int Entity;
+
+const unsigned int NO_COMPONENT = 0xFFFFFFFF;
+
+// Components of one type packed in an array, in no particular order, so systems walk them as
+// contiguous memory. owner holds the entity of every component and a sparse table maps an entity
+// back to its component. Removing swaps the last component into the hole.
+template <typename T>
+class ComponentArray
+{
+public:
+	std::vector<T> data;
+	std::vector<Entity> owner;
+
+	T &add(Entity e, const T &value)
+	{
+		if (e >= slot.size())
+			slot.resize(e + 1, NO_COMPONENT);
+		if (slot[e] != NO_COMPONENT)
+			return data[slot[e]] = value;
+		slot[e] = (unsigned int)data.size();
+		data.push_back(value);
+		owner.push_back(e);
+		return data.back();
+	}
+
+	void remove(Entity e)
+	{
+		if (!has(e))
+			return;
+		unsigned int hole = slot[e];
+		data[hole] = data.back();
+		owner[hole] = owner.back();
+		slot[owner[hole]] = hole;
+		data.pop_back();
+		owner.pop_back();
+		slot[e] = NO_COMPONENT;
+	}
+
+	bool has(Entity e) const
+	{
+		return e < slot.size() && slot[e] != NO_COMPONENT;
+	}
+
+	// NULL when the entity has no such component
+	T *find(Entity e)
+	{
+		return has(e) ? &data[slot[e]] : NULL;
+	}
+
+	const T *find(Entity e) const
+	{
+		return has(e) ? &data[slot[e]] : NULL;
+	}
+
+	T &get(Entity e)
+	{
+		return data[slot[e]];
+	}
+
+	unsigned int size() const
+	{
+		return (unsigned int)data.size();
+	}
+
+private:
+	std::vector<unsigned int> slot;		// Component of each entity, NO_COMPONENT when it has none
+};
+
+// Placement of the entity relative to the parent of its scene entry
+struct Transform
+{
+	glm::vec3 position;
+	glm::quat rotation;
+	glm::vec3 scale;
+};
+
+// Rotation about one axis between two fixed ones: before * axisAngle(angle, axis) * after.
+// The angle is written by a KeyframePlayer, or with a rate it follows the world clock once it
+// passes start: angle = phase + rate * (steps - start), wrapped to wrap degrees when wrap > 0.
+struct Spin
+{
+	glm::quat before;
+	glm::vec3 axis;
+	glm::quat after;
+	float angle;
+	double phase;
+	double rate;				// Degrees per step
+	float wrap;
+	unsigned long long start;
+};
+
+// Circle in the XZ plane, position = center + radius * (cos a, 0, sin a) with
+// a = phase + rate * (steps - start), once the world clock passes start
+struct Orbit
+{
+	glm::vec3 center;
+	float radius;
+	double phase;
+	double rate;				// Radians per step
+	unsigned long long start;
+};
+
+// What a curve channel drives
+enum KeyframeTarget
+{
+	KEYFRAME_X,					// Position, added to the origin of the player
+	KEYFRAME_Y,
+	KEYFRAME_Z,
+	KEYFRAME_SPIN				// Angle of the entity's Spin
+};
+
+struct KeyframeBinding
+{
+	unsigned int channel;
+	KeyframeTarget target;
+	float gain;
+};
+
+const unsigned int KEYFRAME_BINDINGS = 4;
+
+// Plays a BakedCurve on its own clock, which only runs while playing. Several entities may play
+// the same curve, each binding the channels it needs.
+struct KeyframePlayer
+{
+	const BakedCurve *curve;
+	unsigned long long steps;
+	bool playing;
+	glm::vec3 origin;
+	unsigned int bindingCount;
+	KeyframeBinding bindings[KEYFRAME_BINDINGS];
+};
+
+// Scene entry drawn at the entity's Transform
+struct Renderable
+{
+	int entry;
+};
+
+// Animated objects as entities with their state in packed component arrays, instead of one set
+// of globals per character, so a character can be spawned any number of times. Every simulation
+// step update() runs the systems over the arrays (players, then orbits and spins, which take over
+// once they start) and sync() hands the transforms to the scene. The systems write nothing but
+// their own components and transforms, so each one can also run in ranges on a JobSystem.
+// Clocks count simulation steps and everything is computed from them, so nothing drifts.
+class World
+{
+public:
+	ComponentArray<Transform> transforms;
+	ComponentArray<Spin> spins;
+	ComponentArray<Orbit> orbits;
+	ComponentArray<KeyframePlayer> players;
+	ComponentArray<Renderable> renderables;
+
+	explicit World(double stepsPerSecond = 60.0) : rate(stepsPerSecond), count(0), clock(0)
+	{
+	}
+
+	Entity create()
+	{
+		return count++;
+	}
+
+	// Creates an entity drawn as the scene entry, starting at the entry's transform
+	Entity create(const Scene &scene, int entry)
+	{
+		Entity e = create();
+		Transform transform = { scene.position[entry], scene.rotation[entry], scene.scale[entry] };
+		transforms.add(e, transform);
+		Renderable renderable = { entry };
+		renderables.add(e, renderable);
+		return e;
+	}
+
+	unsigned int size() const
+	{
+		return count;
+	}
+
+	unsigned long long steps() const
+	{
+		return clock;
+	}
+
+	// Copies a group of entities (the parts of a character) with all their components and scene
+	// entries. Entries parented inside the group stay so in the copy; the others, and what
+	// positions them (players and orbits), move by offset. Returns the new entities in order.
+	std::vector<Entity> spawn(const std::vector<Entity> &prefab, const glm::vec3 &offset, Scene &scene)
+	{
+		std::vector<Entity> copies(prefab.size());
+		std::vector<int> entries(prefab.size(), -1);
+		for (unsigned int i = 0; i < prefab.size(); i++)
+		{
+			Entity source = prefab[i];
+			Entity copy = copies[i] = create();
+			bool moves = true;
+			if (const Renderable *renderable = renderables.find(source))
+			{
+				int parent = scene.parent[renderable->entry];
+				for (unsigned int j = 0; j < i; j++)
+					if (entries[j] == parent)
+					{
+						parent = renderables.get(copies[j]).entry;
+						moves = false;
+					}
+				entries[i] = renderable->entry;
+				Renderable duplicate = { scene.duplicate(renderable->entry, parent) };
+				renderables.add(copy, duplicate);
+			}
+			if (const Transform *transform = transforms.find(source))
+			{
+				Transform moved = *transform;
+				if (moves)
+					moved.position += offset;
+				transforms.add(copy, moved);
+			}
+			if (const Spin *spin = spins.find(source))
+				spins.add(copy, *spin);
+			if (const Orbit *orbit = orbits.find(source))
+			{
+				Orbit moved = *orbit;
+				if (moves)
+					moved.center += offset;
+				orbits.add(copy, moved);
+			}
+			if (const KeyframePlayer *player = players.find(source))
+			{
+				KeyframePlayer moved = *player;
+				if (moves)
+					moved.origin += offset;
+				players.add(copy, moved);
+			}
+		}
+		return copies;
+	}
+
+	// Advances the world one simulation step. Entities whose model is streamed out keep their
+	// clocks running but are not sampled, they land where they belong when it comes back.
+	void update(const Scene &scene)
+	{
+		clock++;
+		updatePlayers(scene, 0, players.size());
+		updateOrbits(0, orbits.size());
+		updateSpins(0, spins.size());
+	}
+
+	// Same step split in jobs of grain components: the players first, then the orbits and the
+	// spins side by side (they write different parts of the transform). The jobs are only added,
+	// returns the one finishing the step.
+	Job update(const Scene &scene, JobSystem &jobs, unsigned int grain = 256, Job after = NO_JOB)
+	{
+		clock++;
+		const Scene *target = &scene;
+		Job played = jobs.parallelFor(players.size(), grain, [this, target](unsigned int begin, unsigned int end) { updatePlayers(*target, begin, end); }, after);
+		Job orbited = jobs.parallelFor(orbits.size(), grain, [this](unsigned int begin, unsigned int end) { updateOrbits(begin, end); }, played);
+		Job spun = jobs.parallelFor(spins.size(), grain, [this](unsigned int begin, unsigned int end) { updateSpins(begin, end); }, played);
+		Job done = jobs.add(std::function<void()>(), orbited);
+		jobs.depend(done, spun);
+		return done;
+	}
+
+	// Writes the transform of every renderable entity to its scene entry. The scene setters skip
+	// the values that did not change, so still entities cost no matrix rebuild.
+	void sync(Scene &scene) const
+	{
+		for (unsigned int i = 0; i < renderables.size(); i++)
+		{
+			int entry = renderables.data[i].entry;
+			const Transform *transform = transforms.find(renderables.owner[i]);
+			if (transform == NULL)
+				continue;
+			scene.setPosition(entry, transform->position);
+			scene.setRotation(entry, transform->rotation);
+			scene.setScale(entry, transform->scale);
+		}
+	}
+
+private:
+	double rate;				// Steps per second, the clock of the curves
+	Entity count;
+	unsigned long long clock;
+
+	void updatePlayers(const Scene &scene, unsigned int begin, unsigned int end)
+	{
+		std::vector<float> samples;
+		for (unsigned int i = begin; i < end; i++)
+		{
+			KeyframePlayer &player = players.data[i];
+			if (!player.playing)
+				continue;
+			player.steps++;
+			Entity e = players.owner[i];
+			const Renderable *renderable = renderables.find(e);
+			if (renderable != NULL && !scene.resident(renderable->entry))
+				continue;
+			samples.resize(player.curve->channels());
+			player.curve->sample(player.steps / rate, &samples[0]);
+			Transform *transform = transforms.find(e);
+			Spin *spin = spins.find(e);
+			for (unsigned int b = 0; b < player.bindingCount; b++)
+			{
+				const KeyframeBinding &binding = player.bindings[b];
+				float value = binding.gain * samples[binding.channel];
+				if (binding.target == KEYFRAME_SPIN)
+				{
+					if (spin != NULL)
+						spin->angle = value;
+				}
+				else if (transform != NULL)
+					transform->position[binding.target] = player.origin[binding.target] + value;
+			}
+		}
+	}
+
+	void updateOrbits(unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			const Orbit &orbit = orbits.data[i];
+			Transform *transform = transforms.find(orbits.owner[i]);
+			if (clock <= orbit.start || transform == NULL)
+				continue;
+			double angle = orbit.phase + orbit.rate * (clock - orbit.start);
+			transform->position = orbit.center + glm::vec3((float)(orbit.radius * std::cos(angle)), 0.0f, (float)(orbit.radius * std::sin(angle)));
+		}
+	}
+
+	void updateSpins(unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			Spin &spin = spins.data[i];
+			if (spin.rate != 0.0 && clock > spin.start)
+			{
+				double angle = spin.phase + spin.rate * (clock - spin.start);
+				spin.angle = (float)(spin.wrap > 0.0f ? std::fmod(angle, (double)spin.wrap) : angle);
+			}
+			Transform *transform = transforms.find(spins.owner[i]);
+			if (transform != NULL)
+				transform->rotation = spin.before * axisAngle(spin.angle, spin.axis) * spin.after;
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "winmm.lib")
+#endif
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+// Frames kept for the statistics, a few seconds at usual rates
+const unsigned int FRAME_STATS_WINDOW = 240;
+
+// Frame times over the last FRAME_STATS_WINDOW frames, in milliseconds
+struct FrameStats
+{
+	unsigned int frames;
+	double mean;
+	double deviation;
+	double min;
+	double max;
+	double p99;		// 99% of the frames took this long or less
+};
+
+// Paces the render loop against a steady clock with nanosecond resolution. With a target rate,
+// wait() sleeps until shortly before the next frame is due and spins the rest of the way, so the
+// OS scheduler granularity does not add jitter; with rate 0 frames run back to back. Deadlines
+// follow a fixed schedule (previous deadline + period) so errors do not accumulate, and the
+// schedule restarts when a frame overruns by more than a period.
+class FramePacer
+{
+public:
+	double spin;	// Seconds before the deadline where sleeping stops and spinning starts
+
+	explicit FramePacer(double rate = 0.0) : spin(0.002), period(0.0), deadline(0.0), last(-1.0), next(0)
+	{
+		setRate(rate);
+		times.reserve(FRAME_STATS_WINDOW);
+#ifdef _WIN32
+		timeBeginPeriod(1);
+#endif
+	}
+
+	~FramePacer()
+	{
+#ifdef _WIN32
+		timeEndPeriod(1);
+#endif
+	}
+
+	// Frames per second to hold, 0 for no limit
+	void setRate(double rate)
+	{
+		period = rate > 0.0 ? 1.0 / rate : 0.0;
+		deadline = 0.0;
+	}
+
+	double rate() const
+	{
+		return period > 0.0 ? 1.0 / period : 0.0;
+	}
+
+	// Seconds on a steady clock
+	static double now()
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Marks the start of a frame and records the time since the previous one.
+	// Returns that time in seconds (0 on the first frame).
+	double frame()
+	{
+		double start = now();
+		double elapsed = last >= 0.0 ? start - last : 0.0;
+		last = start;
+		if (elapsed > 0.0)
+			record(elapsed * 1000.0);
+		return elapsed;
+	}
+
+	// Blocks until the next frame is due, call it right before presenting
+	void wait()
+	{
+		if (period <= 0.0)
+			return;
+		double current = now();
+		deadline += period;
+		if (deadline < current - period || deadline > current + period)
+			deadline = std::max(last + period, current);
+		for (;;)
+		{
+			double remaining = deadline - now();
+			if (remaining <= 0.0)
+				break;
+			if (remaining > spin)
+				std::this_thread::sleep_for(std::chrono::duration<double>(remaining - spin));
+			else
+				std::this_thread::yield();
+		}
+	}
+
+	FrameStats stats() const
+	{
+		FrameStats result = { 0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+		if (times.empty())
+			return result;
+		result.frames = (unsigned int)times.size();
+		result.min = times[0];
+		result.max = times[0];
+		for (unsigned int i = 0; i < times.size(); i++)
+		{
+			result.mean += times[i];
+			result.min = std::min(result.min, times[i]);
+			result.max = std::max(result.max, times[i]);
+		}
+		result.mean /= times.size();
+		for (unsigned int i = 0; i < times.size(); i++)
+			result.deviation += (times[i] - result.mean) * (times[i] - result.mean);
+		result.deviation = std::sqrt(result.deviation / times.size());
+
+		std::vector<double> sorted(times);
+		unsigned int rank = (unsigned int)(0.99 * (sorted.size() - 1) + 0.5);
+		std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+		result.p99 = sorted[rank];
+		return result;
+	}
+
+private:
+	double period;
+	double deadline;
+	double last;				// Start of the previous frame
+	std::vector<double> times;	// Ring buffer of frame times in milliseconds
+	unsigned int next;
+
+	void record(double milliseconds)
+	{
+		if (times.size() < FRAME_STATS_WINDOW)
+			times.push_back(milliseconds);
+		else
+			times[next] = milliseconds;
+		next = (next + 1) % FRAME_STATS_WINDOW;
+	}
+
+	FramePacer(const FramePacer&);
+	FramePacer &operator=(const FramePacer&);
+};
+
+#endif
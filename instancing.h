@@ -0,0 +1,108 @@
+#ifndef INSTANCING_H
+#define INSTANCING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <shader_m.h>
+#include <staticmodel.h>
+#include <uniforms.h>
+
+#include <vector>
+
+// First vertex attribute used by the per-instance model matrix (takes four consecutive slots).
+// Meshes use the slots below it, so the instanced vertex shader must read it at this location.
+const unsigned int INSTANCE_ATTRIB = 7;
+
+// Draws every copy of a model with one glDrawElementsInstanced per mesh. The world matrices are
+// collected in instances each frame and streamed into a per-instance vertex buffer.
+class InstancedModel
+{
+public:
+	StaticModel *model;
+	std::vector<glm::mat4> instances;
+
+	InstancedModel(StaticModel &m) : model(&m), instanceVBO(0), capacity(0)
+	{
+	}
+
+	// Creates the instance buffer and attaches it to the meshes loaded so far
+	void setup()
+	{
+		glGenBuffers(1, &instanceVBO);
+		attach();
+	}
+
+	// Attaches the instance buffer to the VAO of every full detail mesh of the model. Call it
+	// again whenever the model is uploaded, its vertex arrays are new each time.
+	void attach()
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+		for (unsigned int i = 0; i < fullDetail(); i++)
+		{
+			glBindVertexArray(model->meshes[i].VAO);
+			for (unsigned int c = 0; c < 4; c++)
+			{
+				glEnableVertexAttribArray(INSTANCE_ATTRIB + c);
+				glVertexAttribPointer(INSTANCE_ATTRIB + c, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(c * sizeof(glm::vec4)));
+				glVertexAttribDivisor(INSTANCE_ATTRIB + c, 1);
+			}
+		}
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	// Uploads the collected matrices, growing the buffer only when needed
+	void upload()
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+		if (instances.size() > capacity)
+		{
+			capacity = (unsigned int)instances.size();
+			glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(glm::mat4), &instances[0], GL_DYNAMIC_DRAW);
+		}
+		else if (!instances.empty())
+			glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(glm::mat4), &instances[0]);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	// Issues one instanced draw per full detail mesh
+	void Draw(UniformCache &uniforms)
+	{
+		if (instances.empty())
+			return;
+		upload();
+
+		for (unsigned int i = 0; i < fullDetail(); i++)
+		{
+			StaticMesh &mesh = model->meshes[i];
+			bindTextures(mesh.textures, mesh.samplers, uniforms);
+
+			glBindVertexArray(mesh.VAO);
+			glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)mesh.indexCount, GL_UNSIGNED_INT, (void*)(mesh.firstIndex * sizeof(unsigned int)), (GLsizei)instances.size());
+			glBindVertexArray(0);
+			drawCounters().calls++;
+			drawCounters().triangles += (unsigned long long)(mesh.indexCount / 3) * instances.size();
+			glActiveTexture(GL_TEXTURE0);
+		}
+	}
+
+	void Terminate()
+	{
+		glDeleteBuffers(1, &instanceVBO);
+		instanceVBO = 0;
+		capacity = 0;
+	}
+
+private:
+	unsigned int instanceVBO;
+	unsigned int capacity;
+
+	// Meshes of level 0 come first
+	unsigned int fullDetail() const
+	{
+		return model->levels() > 0 ? model->levelStart[1] : 0;
+	}
+};
+
+#endif
@@ -0,0 +1,221 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef unsigned int Job;
+const Job NO_JOB = 0xFFFFFFFF;
+
+// Runs a graph of small jobs across worker threads and the thread calling run(). Every job keeps a
+// counter of the jobs it still waits for; finishing a job decrements the counters of the ones that
+// depend on it and queues those reaching zero on the thread that finished it. Each thread takes its
+// own newest job first (its data is still in cache) and, when it runs out, steals the oldest job of
+// another thread, so uneven jobs spread by themselves.
+// The graph is built by one thread with add(), depend() and parallelFor(), then run() executes it
+// and clears it for the next one. Job ids are only valid until then.
+class JobSystem
+{
+public:
+	// 0 uses one worker per core, leaving one for the thread calling run()
+	explicit JobSystem(unsigned int count = 0) : queued(0), remaining(0), stopping(false)
+	{
+		if (count == 0)
+		{
+			unsigned int cores = std::thread::hardware_concurrency();
+			count = cores > 1 ? cores - 1 : 0;
+		}
+		for (unsigned int i = 0; i <= count; i++)
+			queues.emplace_back();
+		for (unsigned int i = 1; i <= count; i++)
+			workers.push_back(std::thread(&JobSystem::work, this, i));
+	}
+
+	~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (unsigned int i = 0; i < workers.size(); i++)
+			workers[i].join();
+	}
+
+	// Threads running jobs, the caller of run() included
+	unsigned int threads() const
+	{
+		return (unsigned int)queues.size();
+	}
+
+	// Adds a job that starts once after has finished
+	Job add(const std::function<void()> &task, Job after = NO_JOB)
+	{
+		jobs.emplace_back();
+		Job job = (Job)jobs.size() - 1;
+		jobs.back().task = task;
+		jobs.back().pending = 0;
+		if (after != NO_JOB)
+			depend(job, after);
+		return job;
+	}
+
+	// Makes job wait for on as well
+	void depend(Job job, Job on)
+	{
+		jobs[on].next.push_back(job);
+		jobs[job].pending++;
+	}
+
+	// Splits [0, count) in ranges of grain items, one job each, all starting once after has
+	// finished. Returns a job that finishes with the last range.
+	Job parallelFor(unsigned int count, unsigned int grain, const std::function<void(unsigned int, unsigned int)> &body, Job after = NO_JOB)
+	{
+		Job done = add(std::function<void()>());
+		if (grain == 0)
+			grain = 1;
+		for (unsigned int begin = 0; begin < count; begin += grain)
+		{
+			unsigned int end = count - begin > grain ? begin + grain : count;
+			Job range = add([body, begin, end]() { body(begin, end); }, after);
+			depend(done, range);
+		}
+		if (jobs[done].pending == 0 && after != NO_JOB)
+			depend(done, after);
+		return done;
+	}
+
+	// Runs the graph, the calling thread takes jobs too, and returns once every job finished
+	void run()
+	{
+		if (jobs.empty())
+			return;
+		remaining = (int)jobs.size();
+		// The ready jobs are listed before queueing any, once the first one runs the counters change
+		std::vector<Job> ready;
+		for (Job job = 0; job < jobs.size(); job++)
+			if (jobs[job].pending == 0)
+				ready.push_back(job);
+		for (unsigned int r = 0; r < ready.size(); r++)
+			push(0, ready[r]);
+		while (remaining > 0)
+		{
+			Job job;
+			if (take(0, job))
+			{
+				execute(0, job);
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			wake.wait(lock, [this] { return remaining == 0 || queued > 0; });
+		}
+		jobs.clear();
+	}
+
+private:
+	struct JobData
+	{
+		std::function<void()> task;
+		std::atomic<int> pending;		// Jobs it still waits for
+		std::vector<Job> next;			// Jobs waiting for it
+	};
+
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	std::deque<JobData> jobs;			// Never moves its elements, the counters stay in place
+	std::deque<Queue> queues;			// One per thread, 0 belongs to the caller of run()
+	std::vector<std::thread> workers;
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	std::atomic<int> queued;			// Jobs waiting in any queue
+	std::atomic<int> remaining;			// Jobs of the graph not finished yet
+	bool stopping;
+
+	void push(unsigned int thread, Job job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(queues[thread].mutex);
+			queues[thread].jobs.push_back(job);
+		}
+		queued++;
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		wake.notify_one();
+	}
+
+	bool take(unsigned int thread, Job &job)
+	{
+		if (queued == 0)
+			return false;
+		{
+			Queue &own = queues[thread];
+			std::lock_guard<std::mutex> lock(own.mutex);
+			if (!own.jobs.empty())
+			{
+				job = own.jobs.back();
+				own.jobs.pop_back();
+				queued--;
+				return true;
+			}
+		}
+		for (unsigned int k = 1; k < queues.size(); k++)
+		{
+			Queue &other = queues[(thread + k) % queues.size()];
+			std::lock_guard<std::mutex> lock(other.mutex);
+			if (!other.jobs.empty())
+			{
+				job = other.jobs.front();
+				other.jobs.pop_front();
+				queued--;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void execute(unsigned int thread, Job job)
+	{
+		JobData &data = jobs[job];
+		if (data.task)
+			data.task();
+		for (unsigned int n = 0; n < data.next.size(); n++)
+			if (--jobs[data.next[n]].pending == 0)
+				push(thread, data.next[n]);
+		// The graph may be cleared as soon as the last job is counted, nothing in it is touched after
+		if (--remaining == 0)
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			wake.notify_all();
+		}
+	}
+
+	void work(unsigned int thread)
+	{
+		for (;;)
+		{
+			Job job;
+			if (take(thread, job))
+			{
+				execute(thread, job);
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			wake.wait(lock, [this] { return stopping || queued > 0; });
+			if (stopping)
+				return;
+		}
+	}
+
+	JobSystem(const JobSystem&);
+	JobSystem &operator=(const JobSystem&);
+};
+
+#endif
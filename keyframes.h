@@ -0,0 +1,282 @@
+#ifndef KEYFRAMES_H
+#define KEYFRAMES_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Keys of a clip kept outside the animator (a take file on disk). All its channels share the key
+// times, so they are located together.
+class KeyframeSource
+{
+public:
+	virtual ~KeyframeSource()
+	{
+	}
+
+	virtual unsigned int channels() const = 0;
+	virtual unsigned int frames() const = 0;
+	virtual float duration() const = 0;
+
+	// Values of every channel at the keys around time and the position between both keys
+	virtual void locate(float time, float *from, float *to, float *factor) const = 0;
+};
+
+// Keyframed animation of float channels (a coordinate, an angle...). Every channel has its own
+// track of keys at arbitrary times and is sampled by binary search, so playback can start at any
+// time and never drifts the way adding a per step increment does. Channels are grouped in clips,
+// one per animated object, and every clip runs on its own clock.
+// The keys of all the tracks live in two flat arrays (times and values) and the per channel state
+// is kept as structure of arrays: evaluate() finds the segment of every channel of every clip in
+// one pass and interpolates all of them in a second loop the compiler vectorizes. A clip can also
+// take its keys from a KeyframeSource, such as a take file read from disk as it plays.
+class KeyframeAnimator
+{
+public:
+	// Adds a clip with the given number of channels and returns its index
+	int addClip(unsigned int channels)
+	{
+		Clip clip;
+		clip.firstChannel = (unsigned int)keyFirst.size();
+		clip.channelCount = channels;
+		clip.time = 0.0f;
+		clip.duration = 0.0f;
+		clip.playing = false;
+		clip.loop = false;
+		clip.source = NULL;
+		clips.push_back(clip);
+		for (unsigned int c = 0; c < channels; c++)
+		{
+			keyFirst.push_back((unsigned int)keyTimes.size());
+			keyCount.push_back(0);
+			from.push_back(0.0f);
+			to.push_back(0.0f);
+			factor.push_back(0.0f);
+			values.push_back(0.0f);
+		}
+		return (int)clips.size() - 1;
+	}
+
+	unsigned int channels(int clip) const
+	{
+		return clips[clip].channelCount;
+	}
+
+	// Adds a key to a channel. Keys may come in any order, a key at the time of an existing one
+	// replaces it.
+	void addKey(int clip, unsigned int channel, float time, float value)
+	{
+		unsigned int c = clips[clip].firstChannel + channel;
+		float *times = keyTimes.empty() ? NULL : &keyTimes[0] + keyFirst[c];
+		unsigned int k = (unsigned int)(std::lower_bound(times, times + keyCount[c], time) - times);
+		unsigned int at = keyFirst[c] + k;
+		if (k < keyCount[c] && keyTimes[at] == time)
+		{
+			keyValues[at] = value;
+			return;
+		}
+		keyTimes.insert(keyTimes.begin() + at, time);
+		keyValues.insert(keyValues.begin() + at, value);
+		keyCount[c]++;
+		for (unsigned int d = c + 1; d < keyFirst.size(); d++)
+			keyFirst[d]++;
+		if (clips[clip].source == NULL)
+			clips[clip].duration = std::max(clips[clip].duration, time);
+	}
+
+	// Plays the clip from source instead of its own keys, NULL goes back to them. The source must
+	// have as many channels as the clip and outlive its use.
+	void stream(int clip, const KeyframeSource *source)
+	{
+		Clip &target = clips[clip];
+		target.source = source;
+		target.duration = 0.0f;
+		if (source != NULL)
+			target.duration = source->duration();
+		else
+			for (unsigned int c = target.firstChannel; c < target.firstChannel + target.channelCount; c++)
+				if (keyCount[c] > 0)
+					target.duration = std::max(target.duration, keyTimes[keyFirst[c] + keyCount[c] - 1]);
+		target.time = std::min(target.time, target.duration);
+	}
+
+	const KeyframeSource *source(int clip) const
+	{
+		return clips[clip].source;
+	}
+
+	// Keys of a channel, the frames of the source when the clip streams
+	unsigned int keys(int clip, unsigned int channel) const
+	{
+		if (clips[clip].source != NULL)
+			return clips[clip].source->frames();
+		return keyCount[clips[clip].firstChannel + channel];
+	}
+
+	// Time of key k of a channel of the clip's own keys
+	float keyTime(int clip, unsigned int channel, unsigned int k) const
+	{
+		return keyTimes[keyFirst[clips[clip].firstChannel + channel] + k];
+	}
+
+	// Time of the last key of the clip
+	float duration(int clip) const
+	{
+		return clips[clip].duration;
+	}
+
+	void play(int clip, bool loop = false)
+	{
+		clips[clip].playing = true;
+		clips[clip].loop = loop;
+	}
+
+	void stop(int clip)
+	{
+		clips[clip].playing = false;
+	}
+
+	void seek(int clip, float time)
+	{
+		clips[clip].time = std::max(0.0f, std::min(time, clips[clip].duration));
+	}
+
+	bool playing(int clip) const
+	{
+		return clips[clip].playing;
+	}
+
+	float time(int clip) const
+	{
+		return clips[clip].time;
+	}
+
+	// Moves the clock of every playing clip. A clip reaching its end stops on its last keys, or
+	// starts over when it loops.
+	void advance(float seconds)
+	{
+		for (unsigned int i = 0; i < clips.size(); i++)
+		{
+			Clip &clip = clips[i];
+			if (!clip.playing)
+				continue;
+			clip.time += seconds;
+			if (clip.time < clip.duration)
+				continue;
+			if (clip.loop && clip.duration > 0.0f)
+				clip.time = std::fmod(clip.time, clip.duration);
+			else
+			{
+				clip.time = clip.duration;
+				clip.playing = false;
+			}
+		}
+	}
+
+	// Samples every channel of every clip at the time of its clip. Channels without keys keep
+	// their last value.
+	void evaluate()
+	{
+		for (unsigned int i = 0; i < clips.size(); i++)
+		{
+			const Clip &clip = clips[i];
+			if (clip.source != NULL && clip.channelCount > 0)
+				clip.source->locate(clip.time, &from[clip.firstChannel], &to[clip.firstChannel], &factor[clip.firstChannel]);
+			else
+				for (unsigned int c = clip.firstChannel; c < clip.firstChannel + clip.channelCount; c++)
+					locate(c, clip.time);
+		}
+
+		unsigned int count = (unsigned int)values.size();
+
+		float *out = count > 0 ? &values[0] : NULL;
+		const float *a = count > 0 ? &from[0] : NULL;
+		const float *b = count > 0 ? &to[0] : NULL;
+		const float *t = count > 0 ? &factor[0] : NULL;
+		for (unsigned int c = 0; c < count; c++)
+			out[c] = a[c] + (b[c] - a[c]) * t[c];
+	}
+
+	// Value of a channel after the last evaluate()
+	float value(int clip, unsigned int channel) const
+	{
+		return values[clips[clip].firstChannel + channel];
+	}
+
+	// Samples one channel at any time without touching the clocks
+	float sample(int clip, unsigned int channel, float time) const
+	{
+		const KeyframeSource *source = clips[clip].source;
+		if (source != NULL)
+		{
+			std::vector<float> a(source->channels()), b(source->channels()), t(source->channels());
+			source->locate(time, &a[0], &b[0], &t[0]);
+			return a[channel] + (b[channel] - a[channel]) * t[channel];
+		}
+		unsigned int c = clips[clip].firstChannel + channel;
+		unsigned int n = keyCount[c];
+		if (n == 0)
+			return values[c];
+		const float *times = &keyTimes[keyFirst[c]];
+		const float *keys = &keyValues[keyFirst[c]];
+		unsigned int k = (unsigned int)(std::upper_bound(times, times + n, time) - times);
+		if (k == 0)
+			return keys[0];
+		if (k == n)
+			return keys[n - 1];
+		float t = (time - times[k - 1]) / (times[k] - times[k - 1]);
+		return keys[k - 1] + (keys[k] - keys[k - 1]) * t;
+	}
+
+private:
+	struct Clip
+	{
+		unsigned int firstChannel;
+		unsigned int channelCount;
+		float time;
+		float duration;
+		bool playing;
+		bool loop;
+		const KeyframeSource *source;
+	};
+
+	std::vector<Clip> clips;
+
+	// Keys of every channel, the keys of a channel are contiguous and sorted by time
+	std::vector<float> keyTimes;
+	std::vector<float> keyValues;
+
+	// Per channel
+	std::vector<unsigned int> keyFirst;
+	std::vector<unsigned int> keyCount;
+	std::vector<float> from;		// Values of the keys around the sampled time
+	std::vector<float> to;
+	std::vector<float> factor;		// Position between both keys, in [0, 1]
+	std::vector<float> values;
+
+	// Finds the keys around time for channel c
+	void locate(unsigned int c, float time)
+	{
+		unsigned int n = keyCount[c];
+		if (n == 0)
+		{
+			from[c] = to[c] = values[c];
+			factor[c] = 0.0f;
+			return;
+		}
+		const float *times = &keyTimes[keyFirst[c]];
+		const float *keys = &keyValues[keyFirst[c]];
+		unsigned int k = (unsigned int)(std::upper_bound(times, times + n, time) - times);
+		if (k == 0 || k == n)
+		{
+			from[c] = to[c] = keys[k == 0 ? 0 : n - 1];
+			factor[c] = 0.0f;
+			return;
+		}
+		from[c] = keys[k - 1];
+		to[c] = keys[k];
+		factor[c] = (time - times[k - 1]) / (times[k] - times[k - 1]);
+	}
+};
+
+#endif
@@ -0,0 +1,294 @@
+#ifndef LIGHTS_H
+#define LIGHTS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <shader_m.h>
+#include <uniforms.h>
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+// Number of lights in the block, must match the arrays declared by the shaders
+const unsigned int NR_POINT_LIGHTS = 3;
+const unsigned int NR_SPOT_LIGHTS = 1;
+
+// Uniform buffer binding point shared by every program that declares the Lights block
+const unsigned int LIGHTS_BINDING = 0;
+
+// Uniform keys used by programs without the Lights block
+constexpr UniformKey DIR_LIGHT_KEYS[4] = { "dirLight.direction", "dirLight.ambient", "dirLight.diffuse", "dirLight.specular" };
+constexpr UniformKey POINT_LIGHT_KEYS[NR_POINT_LIGHTS][7] = {
+	{ "pointLight[0].position", "pointLight[0].ambient", "pointLight[0].diffuse", "pointLight[0].specular", "pointLight[0].constant", "pointLight[0].linear", "pointLight[0].quadratic" },
+	{ "pointLight[1].position", "pointLight[1].ambient", "pointLight[1].diffuse", "pointLight[1].specular", "pointLight[1].constant", "pointLight[1].linear", "pointLight[1].quadratic" },
+	{ "pointLight[2].position", "pointLight[2].ambient", "pointLight[2].diffuse", "pointLight[2].specular", "pointLight[2].constant", "pointLight[2].linear", "pointLight[2].quadratic" }
+};
+constexpr UniformKey SPOT_LIGHT_KEYS[NR_SPOT_LIGHTS][10] = {
+	{ "spotLight[0].position", "spotLight[0].direction", "spotLight[0].ambient", "spotLight[0].diffuse", "spotLight[0].specular", "spotLight[0].cutOff", "spotLight[0].outerCutOff", "spotLight[0].constant", "spotLight[0].linear", "spotLight[0].quadratic" }
+};
+
+// C++ mirrors of the std140 layout of these GLSL declarations:
+//
+//   struct DirLight { vec3 direction; vec3 ambient; vec3 diffuse; vec3 specular; };
+//   struct PointLight { vec3 position; vec3 ambient; vec3 diffuse; vec3 specular;
+//                       float constant; float linear; float quadratic; };
+//   struct SpotLight { vec3 position; vec3 direction; vec3 ambient; vec3 diffuse; vec3 specular;
+//                      float cutOff; float outerCutOff; float constant; float linear; float quadratic; };
+//   layout (std140) uniform Lights { DirLight dirLight; PointLight pointLight[3]; SpotLight spotLight[1]; };
+//
+// A float that follows a vec3 takes the fourth slot of that vec3, the pads fill the other gaps.
+struct DirLight
+{
+	glm::vec3 direction;	float pad0;
+	glm::vec3 ambient;		float pad1;
+	glm::vec3 diffuse;		float pad2;
+	glm::vec3 specular;		float pad3;
+};
+
+struct PointLight
+{
+	glm::vec3 position;		float pad0;
+	glm::vec3 ambient;		float pad1;
+	glm::vec3 diffuse;		float pad2;
+	glm::vec3 specular;
+	float constant;
+	float linear;
+	float quadratic;
+	float pad3[2];
+};
+
+struct SpotLight
+{
+	glm::vec3 position;		float pad0;
+	glm::vec3 direction;	float pad1;
+	glm::vec3 ambient;		float pad2;
+	glm::vec3 diffuse;		float pad3;
+	glm::vec3 specular;
+	float cutOff;
+	float outerCutOff;
+	float constant;
+	float linear;
+	float quadratic;
+};
+
+struct LightBlock
+{
+	DirLight dirLight;
+	PointLight pointLight[NR_POINT_LIGHTS];
+	SpotLight spotLight[NR_SPOT_LIGHTS];
+};
+
+static_assert(sizeof(DirLight) == 64, "DirLight does not match std140");
+static_assert(sizeof(PointLight) == 80, "PointLight does not match std140");
+static_assert(sizeof(SpotLight) == 96, "SpotLight does not match std140");
+
+// Holds the state of every light and sends it to the programs only when it changes.
+// Programs that declare the Lights block read it from one uniform buffer shared by all of them,
+// programs that still use plain uniforms get only the lights that changed since their last apply().
+class Lights
+{
+public:
+	LightBlock block;
+
+	Lights() : ubo(0)
+	{
+		block = LightBlock();
+		for (unsigned int i = 0; i < LIGHT_COUNT; i++)
+		{
+			version[i] = 1;
+			uploaded[i] = 0;
+		}
+	}
+
+	// Creates the uniform buffer, needs a current GL context
+	void setup()
+	{
+		glGenBuffers(1, &ubo);
+		glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(LightBlock), NULL, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		glBindBufferBase(GL_UNIFORM_BUFFER, LIGHTS_BINDING, ubo);
+	}
+
+	void setDirLight(glm::vec3 direction, glm::vec3 ambient, glm::vec3 diffuse, glm::vec3 specular)
+	{
+		DirLight light = DirLight();
+		light.direction = direction;
+		light.ambient = ambient;
+		light.diffuse = diffuse;
+		light.specular = specular;
+		store(&block.dirLight, &light, sizeof(light), 0);
+	}
+
+	void setPointLight(unsigned int index, glm::vec3 position, glm::vec3 ambient, glm::vec3 diffuse, glm::vec3 specular, float constant, float linear, float quadratic)
+	{
+		PointLight light = PointLight();
+		light.position = position;
+		light.ambient = ambient;
+		light.diffuse = diffuse;
+		light.specular = specular;
+		light.constant = constant;
+		light.linear = linear;
+		light.quadratic = quadratic;
+		store(&block.pointLight[index], &light, sizeof(light), 1 + index);
+	}
+
+	void setSpotLight(unsigned int index, glm::vec3 position, glm::vec3 direction, glm::vec3 ambient, glm::vec3 diffuse, glm::vec3 specular,
+		float cutOff, float outerCutOff, float constant, float linear, float quadratic)
+	{
+		SpotLight light = SpotLight();
+		light.position = position;
+		light.direction = direction;
+		light.ambient = ambient;
+		light.diffuse = diffuse;
+		light.specular = specular;
+		light.cutOff = cutOff;
+		light.outerCutOff = outerCutOff;
+		light.constant = constant;
+		light.linear = linear;
+		light.quadratic = quadratic;
+		store(&block.spotLight[index], &light, sizeof(light), 1 + NR_POINT_LIGHTS + index);
+	}
+
+	// Brings the program up to date, it must be the program in use
+	void apply(UniformCache &uniforms)
+	{
+		Program &program = find(uniforms.shader->ID);
+		if (program.usesBlock)
+		{
+			flush();
+			return;
+		}
+
+		for (unsigned int i = 0; i < LIGHT_COUNT; i++)
+		{
+			if (program.applied[i] == version[i])
+				continue;
+			if (i == 0)
+				sendDirLight(uniforms);
+			else if (i <= NR_POINT_LIGHTS)
+				sendPointLight(uniforms, i - 1);
+			else
+				sendSpotLight(uniforms, i - 1 - NR_POINT_LIGHTS);
+			program.applied[i] = version[i];
+		}
+	}
+
+	void Terminate()
+	{
+		glDeleteBuffers(1, &ubo);
+		ubo = 0;
+	}
+
+private:
+	static const unsigned int LIGHT_COUNT = 1 + NR_POINT_LIGHTS + NR_SPOT_LIGHTS;
+
+	struct Program
+	{
+		unsigned int id;
+		bool usesBlock;
+		unsigned int applied[LIGHT_COUNT];
+	};
+
+	unsigned int ubo;
+	unsigned int version[LIGHT_COUNT];	// Bumped every time a light changes
+	unsigned int uploaded[LIGHT_COUNT];	// Version held by the uniform buffer
+	std::vector<Program> programs;
+
+	void store(void *dst, const void *src, size_t size, unsigned int light)
+	{
+		if (std::memcmp(dst, src, size) == 0)
+			return;
+		std::memcpy(dst, src, size);
+		version[light]++;
+	}
+
+	Program &find(unsigned int id)
+	{
+		for (unsigned int i = 0; i < programs.size(); i++)
+			if (programs[i].id == id)
+				return programs[i];
+
+		Program program;
+		program.id = id;
+		program.usesBlock = false;
+		for (unsigned int i = 0; i < LIGHT_COUNT; i++)
+			program.applied[i] = 0;
+
+		unsigned int blockIndex = glGetUniformBlockIndex(id, "Lights");
+		if (blockIndex != GL_INVALID_INDEX && ubo != 0)
+		{
+			glUniformBlockBinding(id, blockIndex, LIGHTS_BINDING);
+			program.usesBlock = true;
+		}
+		programs.push_back(program);
+		return programs.back();
+	}
+
+	// Uploads only the lights that changed since the last upload
+	void flush()
+	{
+		bool bound = false;
+		for (unsigned int i = 0; i < LIGHT_COUNT; i++)
+		{
+			if (uploaded[i] == version[i])
+				continue;
+			if (!bound)
+			{
+				glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+				bound = true;
+			}
+			if (i == 0)
+				glBufferSubData(GL_UNIFORM_BUFFER, offsetof(LightBlock, dirLight), sizeof(DirLight), &block.dirLight);
+			else if (i <= NR_POINT_LIGHTS)
+				glBufferSubData(GL_UNIFORM_BUFFER, offsetof(LightBlock, pointLight) + (i - 1) * sizeof(PointLight), sizeof(PointLight), &block.pointLight[i - 1]);
+			else
+				glBufferSubData(GL_UNIFORM_BUFFER, offsetof(LightBlock, spotLight) + (i - 1 - NR_POINT_LIGHTS) * sizeof(SpotLight), sizeof(SpotLight), &block.spotLight[i - 1 - NR_POINT_LIGHTS]);
+			uploaded[i] = version[i];
+		}
+		if (bound)
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	void sendDirLight(UniformCache &uniforms)
+	{
+		const DirLight &light = block.dirLight;
+		uniforms.setVec3(DIR_LIGHT_KEYS[0], light.direction);
+		uniforms.setVec3(DIR_LIGHT_KEYS[1], light.ambient);
+		uniforms.setVec3(DIR_LIGHT_KEYS[2], light.diffuse);
+		uniforms.setVec3(DIR_LIGHT_KEYS[3], light.specular);
+	}
+
+	void sendPointLight(UniformCache &uniforms, unsigned int index)
+	{
+		const PointLight &light = block.pointLight[index];
+		const UniformKey *keys = POINT_LIGHT_KEYS[index];
+		uniforms.setVec3(keys[0], light.position);
+		uniforms.setVec3(keys[1], light.ambient);
+		uniforms.setVec3(keys[2], light.diffuse);
+		uniforms.setVec3(keys[3], light.specular);
+		uniforms.setFloat(keys[4], light.constant);
+		uniforms.setFloat(keys[5], light.linear);
+		uniforms.setFloat(keys[6], light.quadratic);
+	}
+
+	void sendSpotLight(UniformCache &uniforms, unsigned int index)
+	{
+		const SpotLight &light = block.spotLight[index];
+		const UniformKey *keys = SPOT_LIGHT_KEYS[index];
+		uniforms.setVec3(keys[0], light.position);
+		uniforms.setVec3(keys[1], light.direction);
+		uniforms.setVec3(keys[2], light.ambient);
+		uniforms.setVec3(keys[3], light.diffuse);
+		uniforms.setVec3(keys[4], light.specular);
+		uniforms.setFloat(keys[5], light.cutOff);
+		uniforms.setFloat(keys[6], light.outerCutOff);
+		uniforms.setFloat(keys[7], light.constant);
+		uniforms.setFloat(keys[8], light.linear);
+		uniforms.setFloat(keys[9], light.quadratic);
+	}
+};
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef LOD_H
+#define LOD_H
+
+#include <glm/glm.hpp>
+
+#include <mesh.h>
+
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+// Detail levels per model, level 0 is the model as loaded
+const unsigned int LOD_LEVELS = 3;
+
+// Grid cells along the longest side of the model used to simplify each level
+const unsigned int LOD_GRID[LOD_LEVELS] = { 0, 96, 32 };
+
+// Projected size (bounding sphere radius over half the screen height) under which each level is used
+const float LOD_SCREEN_SIZE[LOD_LEVELS] = { 0.0f, 0.35f, 0.12f };
+
+// Fraction a size has to go past a threshold before the level changes, avoids flicker at the border
+const float LOD_HYSTERESIS = 0.2f;
+
+// Picks the level for a projected size starting from the level used last frame
+inline unsigned int selectLod(float size, unsigned int current, unsigned int levels)
+{
+	unsigned int level = current < levels ? current : levels - 1;
+	while (level + 1 < levels && size < LOD_SCREEN_SIZE[level + 1] * (1.0f - LOD_HYSTERESIS))
+		level++;
+	while (level > 0 && size > LOD_SCREEN_SIZE[level] * (1.0f + LOD_HYSTERESIS))
+		level--;
+	return level;
+}
+
+// Quadric error of a point against the planes accumulated in q (xx xy xz xw yy yz yw zz zw ww)
+inline double quadricError(const double *q, const glm::vec3 &p)
+{
+	double x = p.x, y = p.y, z = p.z;
+	return q[0] * x * x + 2.0 * q[1] * x * y + 2.0 * q[2] * x * z + 2.0 * q[3] * x
+		+ q[4] * y * y + 2.0 * q[5] * y * z + 2.0 * q[6] * y
+		+ q[7] * z * z + 2.0 * q[8] * z + q[9];
+}
+
+// Simplifies a mesh by vertex clustering guided by quadric error. Vertices are grouped in the cells
+// of a uniform grid, every cell keeps the original vertex that best fits the planes of the triangles
+// around it and the triangles that collapse are dropped. Keeping an original vertex keeps its normal
+// and texture coordinates. Meshes of the same model must share origin and cell so they stay sealed.
+inline void simplifyMesh(const Vertex *source, unsigned int vertexCount, const unsigned int *sourceIndices, unsigned int indexCount,
+	const glm::vec3 &origin, float cell, std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
+{
+	vertices.clear();
+	indices.clear();
+
+	std::unordered_map<unsigned long long, unsigned int> cells;
+	std::vector<unsigned int> cellOf(vertexCount);
+	for (unsigned int v = 0; v < vertexCount; v++)
+	{
+		glm::vec3 g = (source[v].Position - origin) / cell;
+		unsigned long long key = ((unsigned long long)(std::floor(g.x) + 1048576.0f) & 0x1FFFFF)
+			| (((unsigned long long)(std::floor(g.y) + 1048576.0f) & 0x1FFFFF) << 21)
+			| (((unsigned long long)(std::floor(g.z) + 1048576.0f) & 0x1FFFFF) << 42);
+		std::unordered_map<unsigned long long, unsigned int>::iterator it = cells.find(key);
+		if (it == cells.end())
+			it = cells.insert(std::make_pair(key, (unsigned int)cells.size())).first;
+		cellOf[v] = it->second;
+	}
+
+	// Planes of the triangles, weighted by area, added to the cells of their corners
+	std::vector<double> quadrics(cells.size() * 10, 0.0);
+	for (unsigned int t = 0; t + 2 < indexCount; t += 3)
+	{
+		const glm::vec3 &p0 = source[sourceIndices[t]].Position;
+		glm::vec3 n = glm::cross(source[sourceIndices[t + 1]].Position - p0, source[sourceIndices[t + 2]].Position - p0);
+		float area = glm::length(n);
+		if (area <= 0.0f)
+			continue;
+		n /= area;
+		double a = n.x, b = n.y, c = n.z, d = -glm::dot(n, p0), w = area * 0.5;
+		double plane[10] = { a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d };
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			double *q = &quadrics[cellOf[sourceIndices[t + k]] * 10];
+			for (unsigned int j = 0; j < 10; j++)
+				q[j] += plane[j] * w;
+		}
+	}
+
+	std::vector<int> best(cells.size(), -1);
+	std::vector<double> bestError(cells.size(), 0.0);
+	for (unsigned int v = 0; v < vertexCount; v++)
+	{
+		unsigned int c = cellOf[v];
+		double error = quadricError(&quadrics[c * 10], source[v].Position);
+		if (best[c] < 0 || error < bestError[c])
+		{
+			best[c] = v;
+			bestError[c] = error;
+		}
+	}
+
+	std::vector<int> remap(cells.size(), -1);
+	for (unsigned int t = 0; t + 2 < indexCount; t += 3)
+	{
+		unsigned int c0 = cellOf[sourceIndices[t]], c1 = cellOf[sourceIndices[t + 1]], c2 = cellOf[sourceIndices[t + 2]];
+		if (c0 == c1 || c1 == c2 || c0 == c2)
+			continue;
+		unsigned int corner[3] = { c0, c1, c2 };
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			if (remap[corner[k]] < 0)
+			{
+				remap[corner[k]] = (int)vertices.size();
+				vertices.push_back(source[best[corner[k]]]);
+			}
+			indices.push_back(remap[corner[k]]);
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,382 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <glm/glm.hpp>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <mesh.h>
+#include <bounds.h>
+#include <lod.h>
+#include <mappedfile.h>
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Preprocessed models: the first time an .obj is loaded it is parsed with Assimp, its detail
+// levels are generated and everything is written next to it with .mbin appended to its name.
+// Later runs map that file and hand the vertex and index blobs straight to the GPU. The cache is
+// rebuilt when the .obj is newer than it, when it was written by another version of this code or
+// when it was built from a file of another name.
+//
+// Layout of an .mbin file, every section 4 byte aligned:
+//   MeshCacheHeader
+//   MeshRecord[meshCount]
+//   TextureRecord[textureCount]
+//   Vertex[vertexCount]			interleaved, the layout Mesh uploads
+//   unsigned int[indexCount]		relative to the first vertex of their mesh
+//   char[stringBytes]				zero terminated type and path of every texture
+//   char[sourceBytes]				name of the model the cache was built from
+const unsigned int MESH_CACHE_MAGIC = 0x4E49424D;	// "MBIN"
+
+// Bump when the layout or the generation of the levels changes
+const unsigned int MESH_CACHE_VERSION = 2;
+
+struct MeshCacheHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int vertexSize;	// sizeof(Vertex) of the writer, Vertex differs between Mesh versions
+	unsigned int levels;
+	unsigned int meshCount;
+	unsigned int textureCount;
+	unsigned int vertexCount;
+	unsigned int indexCount;
+	unsigned int stringBytes;
+	unsigned int sourceBytes;
+	float min[3];
+	float max[3];
+	float center[3];
+	float radius;
+};
+
+// A mesh of one detail level, its textures are textures [firstTexture, firstTexture + textureCount)
+struct MeshRecord
+{
+	unsigned int level;
+	unsigned int firstVertex;
+	unsigned int vertexCount;
+	unsigned int firstIndex;
+	unsigned int indexCount;
+	unsigned int firstTexture;
+	unsigned int textureCount;
+};
+
+// Offsets of the texture strings in the string table
+struct TextureRecord
+{
+	unsigned int type;
+	unsigned int path;
+};
+
+struct TextureRef
+{
+	std::string type;	// texture_diffuse, texture_specular, ...
+	std::string path;	// Relative to the directory of the model
+};
+
+// CPU side of a model ready for upload. The blobs either live in the storage vectors (fresh
+// import) or point into the mapped cache file, which stays open as long as this object does.
+struct ModelData
+{
+	std::string directory;
+	Bounds bounds;
+	unsigned int levels;
+	std::vector<MeshRecord> meshes;	// Sorted by level
+	std::vector<TextureRef> textures;
+
+	const Vertex *vertices;
+	unsigned int vertexCount;
+	const unsigned int *indices;
+	unsigned int indexCount;
+
+	std::vector<Vertex> vertexStorage;
+	std::vector<unsigned int> indexStorage;
+	MappedFile file;
+
+	ModelData() : levels(0), vertices(NULL), vertexCount(0), indices(NULL), indexCount(0)
+	{
+	}
+
+	// Points the blobs at the storage vectors
+	void own()
+	{
+		vertices = vertexStorage.empty() ? NULL : &vertexStorage[0];
+		vertexCount = (unsigned int)vertexStorage.size();
+		indices = indexStorage.empty() ? NULL : &indexStorage[0];
+		indexCount = (unsigned int)indexStorage.size();
+	}
+};
+
+// Name of the cache of a model: the whole path with .mbin appended, so models that only differ
+// in their extension get caches of their own
+inline std::string meshCachePath(const std::string &path)
+{
+	return path + ".mbin";
+}
+
+inline void importMaterial(const aiMaterial *material, aiTextureType type, const char *typeName, ModelData &data)
+{
+	for (unsigned int i = 0; i < material->GetTextureCount(type); i++)
+	{
+		aiString str;
+		material->GetTexture(type, i, &str);
+		TextureRef texture;
+		texture.type = typeName;
+		texture.path = str.C_Str();
+		data.textures.push_back(texture);
+	}
+}
+
+// Same conversion Model::processMesh does, appended to the level 0 blobs
+inline void importMesh(const aiMesh *mesh, const aiScene *scene, ModelData &data)
+{
+	MeshRecord record;
+	record.level = 0;
+	record.firstVertex = (unsigned int)data.vertexStorage.size();
+	record.vertexCount = mesh->mNumVertices;
+	record.firstIndex = (unsigned int)data.indexStorage.size();
+	record.firstTexture = (unsigned int)data.textures.size();
+
+	for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+	{
+		Vertex vertex = Vertex();
+		vertex.Position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+		if (mesh->HasNormals())
+			vertex.Normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+		if (mesh->mTextureCoords[0])
+		{
+			vertex.TexCoords = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
+			if (mesh->HasTangentsAndBitangents())
+			{
+				vertex.Tangent = glm::vec3(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z);
+				vertex.Bitangent = glm::vec3(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z);
+			}
+		}
+		data.vertexStorage.push_back(vertex);
+	}
+	for (unsigned int f = 0; f < mesh->mNumFaces; f++)
+		for (unsigned int j = 0; j < mesh->mFaces[f].mNumIndices; j++)
+			data.indexStorage.push_back(mesh->mFaces[f].mIndices[j]);
+	record.indexCount = (unsigned int)data.indexStorage.size() - record.firstIndex;
+
+	const aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
+	importMaterial(material, aiTextureType_DIFFUSE, "texture_diffuse", data);
+	importMaterial(material, aiTextureType_SPECULAR, "texture_specular", data);
+	importMaterial(material, aiTextureType_HEIGHT, "texture_normal", data);
+	importMaterial(material, aiTextureType_AMBIENT, "texture_height", data);
+	record.textureCount = (unsigned int)data.textures.size() - record.firstTexture;
+	data.meshes.push_back(record);
+}
+
+inline void importNode(const aiNode *node, const aiScene *scene, ModelData &data)
+{
+	for (unsigned int i = 0; i < node->mNumMeshes; i++)
+		importMesh(scene->mMeshes[node->mMeshes[i]], scene, data);
+	for (unsigned int i = 0; i < node->mNumChildren; i++)
+		importNode(node->mChildren[i], scene, data);
+}
+
+// Appends the simplified levels of the level 0 meshes. Every level uses one grid for all the
+// meshes so they stay sealed. A grid that does not remove at least a quarter of the triangles of
+// the previous level is dropped and the next coarser one is tried instead.
+inline void buildLevels(ModelData &data)
+{
+	glm::vec3 size = data.bounds.max - data.bounds.min;
+	float longest = glm::max(size.x, glm::max(size.y, size.z));
+	if (longest <= 0.0f)
+		return;
+
+	unsigned int baseMeshes = (unsigned int)data.meshes.size();
+	size_t previous = data.indexStorage.size();
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	for (unsigned int l = 1; l < LOD_LEVELS; l++)
+	{
+		float cell = longest / LOD_GRID[l];
+		size_t levelMeshes = data.meshes.size();
+		size_t levelVertices = data.vertexStorage.size();
+		size_t levelIndices = data.indexStorage.size();
+		for (unsigned int m = 0; m < baseMeshes; m++)
+		{
+			MeshRecord base = data.meshes[m];
+			if (base.indexCount == 0)
+				continue;
+			simplifyMesh(&data.vertexStorage[base.firstVertex], base.vertexCount, &data.indexStorage[base.firstIndex], base.indexCount,
+				data.bounds.min, cell, vertices, indices);
+			if (indices.empty())
+				continue;
+			MeshRecord record = base;
+			record.level = data.levels;
+			record.firstVertex = (unsigned int)data.vertexStorage.size();
+			record.vertexCount = (unsigned int)vertices.size();
+			record.firstIndex = (unsigned int)data.indexStorage.size();
+			record.indexCount = (unsigned int)indices.size();
+			data.vertexStorage.insert(data.vertexStorage.end(), vertices.begin(), vertices.end());
+			data.indexStorage.insert(data.indexStorage.end(), indices.begin(), indices.end());
+			data.meshes.push_back(record);
+		}
+
+		size_t count = data.indexStorage.size() - levelIndices;
+		if (count == 0 || count * 4 > previous * 3)
+		{
+			data.meshes.resize(levelMeshes);
+			data.vertexStorage.resize(levelVertices);
+			data.indexStorage.resize(levelIndices);
+			continue;
+		}
+		data.levels++;
+		previous = count;
+	}
+}
+
+// Parses a model file with Assimp, computes its bounds and generates its detail levels
+inline bool importModel(const std::string &path, ModelData &data)
+{
+	Assimp::Importer importer;
+	const aiScene *scene = importer.ReadFile(path.c_str(), aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+	{
+		std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+		return false;
+	}
+
+	importNode(scene->mRootNode, scene, data);
+	data.levels = 1;
+	data.bounds = computeBounds(data.vertexStorage.empty() ? NULL : &data.vertexStorage[0], (unsigned int)data.vertexStorage.size());
+	buildLevels(data);
+	data.own();
+	return true;
+}
+
+inline bool writeMeshCache(const std::string &path, const std::string &source, const ModelData &data)
+{
+	std::vector<TextureRecord> records;
+	std::string strings;
+	for (unsigned int i = 0; i < data.textures.size(); i++)
+	{
+		TextureRecord record;
+		record.type = (unsigned int)strings.size();
+		strings.append(data.textures[i].type.c_str(), data.textures[i].type.size() + 1);
+		record.path = (unsigned int)strings.size();
+		strings.append(data.textures[i].path.c_str(), data.textures[i].path.size() + 1);
+		records.push_back(record);
+	}
+
+	MeshCacheHeader header;
+	std::memset(&header, 0, sizeof(header));
+	header.magic = MESH_CACHE_MAGIC;
+	header.version = MESH_CACHE_VERSION;
+	header.vertexSize = sizeof(Vertex);
+	header.levels = data.levels;
+	header.meshCount = (unsigned int)data.meshes.size();
+	header.textureCount = (unsigned int)records.size();
+	header.vertexCount = data.vertexCount;
+	header.indexCount = data.indexCount;
+	header.stringBytes = (unsigned int)strings.size();
+	header.sourceBytes = (unsigned int)source.size();
+	for (int k = 0; k < 3; k++)
+	{
+		header.min[k] = data.bounds.min[k];
+		header.max[k] = data.bounds.max[k];
+		header.center[k] = data.bounds.center[k];
+	}
+	header.radius = data.bounds.radius;
+
+	std::string temporary = temporaryPath(path);
+	FILE *file = std::fopen(temporary.c_str(), "wb");
+	if (file == NULL)
+		return false;
+	bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+	if (ok && header.meshCount > 0)
+		ok = std::fwrite(&data.meshes[0], sizeof(MeshRecord), header.meshCount, file) == header.meshCount;
+	if (ok && header.textureCount > 0)
+		ok = std::fwrite(&records[0], sizeof(TextureRecord), header.textureCount, file) == header.textureCount;
+	if (ok && header.vertexCount > 0)
+		ok = std::fwrite(data.vertices, sizeof(Vertex), header.vertexCount, file) == header.vertexCount;
+	if (ok && header.indexCount > 0)
+		ok = std::fwrite(data.indices, sizeof(unsigned int), header.indexCount, file) == header.indexCount;
+	if (ok && header.stringBytes > 0)
+		ok = std::fwrite(strings.data(), 1, header.stringBytes, file) == header.stringBytes;
+	if (ok && header.sourceBytes > 0)
+		ok = std::fwrite(source.data(), 1, header.sourceBytes, file) == header.sourceBytes;
+	ok = std::fclose(file) == 0 && ok;
+	return replaceFile(temporary, path, ok);
+}
+
+// Maps a cache file, returns false when it is missing, truncated, from another version or built
+// from a model other than source
+inline bool readMeshCache(const std::string &path, const std::string &source, ModelData &data)
+{
+	if (!data.file.open(path.c_str()))
+		return false;
+	const unsigned char *bytes = data.file.data();
+	size_t size = data.file.size();
+
+	MeshCacheHeader header;
+	if (size < sizeof(header))
+	{
+		data.file.close();
+		return false;
+	}
+	std::memcpy(&header, bytes, sizeof(header));
+	size_t meshOffset = sizeof(header);
+	size_t textureOffset = meshOffset + (size_t)header.meshCount * sizeof(MeshRecord);
+	size_t vertexOffset = textureOffset + (size_t)header.textureCount * sizeof(TextureRecord);
+	size_t indexOffset = vertexOffset + (size_t)header.vertexCount * sizeof(Vertex);
+	size_t stringOffset = indexOffset + (size_t)header.indexCount * sizeof(unsigned int);
+	size_t sourceOffset = stringOffset + header.stringBytes;
+	if (header.magic != MESH_CACHE_MAGIC || header.version != MESH_CACHE_VERSION || header.vertexSize != sizeof(Vertex)
+		|| sourceOffset + header.sourceBytes != size || header.sourceBytes != source.size()
+		|| std::memcmp(bytes + sourceOffset, source.data(), source.size()) != 0)
+	{
+		data.file.close();
+		return false;
+	}
+
+	data.levels = header.levels;
+	data.meshes.resize(header.meshCount);
+	if (header.meshCount > 0)
+		std::memcpy(&data.meshes[0], bytes + meshOffset, header.meshCount * sizeof(MeshRecord));
+	const char *strings = (const char*)bytes + stringOffset;
+	data.textures.resize(header.textureCount);
+	for (unsigned int i = 0; i < header.textureCount; i++)
+	{
+		TextureRecord record;
+		std::memcpy(&record, bytes + textureOffset + i * sizeof(TextureRecord), sizeof(record));
+		data.textures[i].type = strings + record.type;
+		data.textures[i].path = strings + record.path;
+	}
+	data.vertices = (const Vertex*)(bytes + vertexOffset);
+	data.vertexCount = header.vertexCount;
+	data.indices = (const unsigned int*)(bytes + indexOffset);
+	data.indexCount = header.indexCount;
+	data.bounds.min = glm::vec3(header.min[0], header.min[1], header.min[2]);
+	data.bounds.max = glm::vec3(header.max[0], header.max[1], header.max[2]);
+	data.bounds.center = glm::vec3(header.center[0], header.center[1], header.center[2]);
+	data.bounds.radius = header.radius;
+	return true;
+}
+
+// Fills data from the cache of path, importing the model and writing the cache first when the
+// cache is missing, older than the model or unreadable. Only touches the CPU, any thread can call it.
+inline bool loadModelData(const std::string &path, ModelData &data)
+{
+	data.directory = path.substr(0, path.find_last_of("/\\"));
+	std::string cache = meshCachePath(path);
+	std::string source = fileName(path);
+	if (fileTime(cache) >= fileTime(path) && readMeshCache(cache, source, data))
+		return true;
+
+	if (!importModel(path, data))
+		return false;
+	if (!writeMeshCache(cache, source, data))
+		std::cout << "Failed to write mesh cache: " << cache << std::endl;
+	return true;
+}
+
+#endif
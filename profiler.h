@@ -0,0 +1,256 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Frames in flight before the GPU timestamps of a frame are read back, so reading them never
+// waits for the GPU
+const unsigned int PROFILER_LATENCY = 4;
+
+// Times named sections of every frame on the CPU (steady clock) and on the GPU (GL timestamp
+// queries) while a capture is running, and writes the capture as a Chrome trace that
+// chrome://tracing or ui.perfetto.dev can open. CPU sections go to one track and GPU ones to
+// another, both on the CPU time line. Sections nest; outside a capture they cost one branch.
+class Profiler
+{
+public:
+	Profiler() : requested(false), capturing(false), inFrame(false), frameIndex(0), origin(0.0)
+	{
+	}
+
+	bool recording() const
+	{
+		return capturing || requested;
+	}
+
+	// The capture starts with the next frame
+	void start()
+	{
+		requested = true;
+	}
+
+	// Ends the capture and writes it to path, waiting for the GPU times still in flight.
+	// Call it between frames on the GL thread.
+	bool stop(const std::string &path)
+	{
+		requested = false;
+		if (!capturing)
+			return false;
+		for (unsigned int f = 0; f < PROFILER_LATENCY; f++)
+			if (frames[f].pending)
+				resolve(frames[f]);
+		capturing = false;
+		bool written = writeTrace(path);
+		events.clear();
+		return written;
+	}
+
+	void beginFrame()
+	{
+		if (requested && !capturing)
+		{
+			capturing = true;
+			origin = now();
+			events.clear();
+		}
+		if (!capturing)
+			return;
+
+		Frame &frame = current();
+		if (frame.pending)
+			resolve(frame);
+		frame.sections.clear();
+		frame.used = 0;
+		frame.pending = true;
+		frame.number = frameIndex;
+		GLint64 gpu = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpu);
+		frame.offset = now() - gpu * 1.0e-9;
+		inFrame = true;
+		begin("Frame");
+	}
+
+	void endFrame()
+	{
+		if (!inFrame)
+			return;
+		end();
+		inFrame = false;
+		frameIndex++;
+	}
+
+	void begin(const char *name)
+	{
+		if (!inFrame)
+			return;
+		Frame &frame = current();
+		Section section;
+		section.name = name;
+		section.query = frame.used;
+		frame.used += 2;
+		while (frame.queries.size() < frame.used)
+		{
+			unsigned int query;
+			glGenQueries(1, &query);
+			frame.queries.push_back(query);
+		}
+		glQueryCounter(frame.queries[section.query], GL_TIMESTAMP);
+		section.cpuBegin = now();
+		section.cpuEnd = section.cpuBegin;
+		open.push_back((unsigned int)frame.sections.size());
+		frame.sections.push_back(section);
+	}
+
+	void end()
+	{
+		if (!inFrame || open.empty())
+			return;
+		Frame &frame = current();
+		Section &section = frame.sections[open.back()];
+		open.pop_back();
+		section.cpuEnd = now();
+		glQueryCounter(frame.queries[section.query + 1], GL_TIMESTAMP);
+	}
+
+	void Terminate()
+	{
+		for (unsigned int f = 0; f < PROFILER_LATENCY; f++)
+		{
+			if (!frames[f].queries.empty())
+				glDeleteQueries((GLsizei)frames[f].queries.size(), &frames[f].queries[0]);
+			frames[f].queries.clear();
+			frames[f].pending = false;
+		}
+	}
+
+private:
+	struct Section
+	{
+		std::string name;
+		unsigned int query;		// Begin timestamp, the end one follows it
+		double cpuBegin;
+		double cpuEnd;
+	};
+
+	struct Frame
+	{
+		std::vector<Section> sections;
+		std::vector<unsigned int> queries;	// Reused from capture to capture
+		unsigned int used;
+		unsigned int number;
+		double offset;		// CPU time minus GPU time when the frame began, in seconds
+		bool pending;
+
+		Frame() : used(0), number(0), offset(0.0), pending(false)
+		{
+		}
+	};
+
+	// A complete event of the trace, times in microseconds from the start of the capture
+	struct TraceEvent
+	{
+		std::string name;
+		unsigned int frame;
+		unsigned int track;		// 1 CPU, 2 GPU
+		double start;
+		double duration;
+	};
+
+	bool requested;
+	bool capturing;
+	bool inFrame;
+	unsigned int frameIndex;
+	double origin;
+	Frame frames[PROFILER_LATENCY];
+	std::vector<unsigned int> open;	// Sections begun and not ended yet
+	std::vector<TraceEvent> events;
+
+	static double now()
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	Frame &current()
+	{
+		return frames[frameIndex % PROFILER_LATENCY];
+	}
+
+	// Reads the GPU times of a finished frame and turns its sections into trace events
+	void resolve(Frame &frame)
+	{
+		for (unsigned int s = 0; s < frame.sections.size(); s++)
+		{
+			const Section &section = frame.sections[s];
+			GLuint64 gpuBegin = 0, gpuEnd = 0;
+			glGetQueryObjectui64v(frame.queries[section.query], GL_QUERY_RESULT, &gpuBegin);
+			glGetQueryObjectui64v(frame.queries[section.query + 1], GL_QUERY_RESULT, &gpuEnd);
+
+			TraceEvent event;
+			event.name = section.name;
+			event.frame = frame.number;
+			event.track = 1;
+			event.start = (section.cpuBegin - origin) * 1.0e6;
+			event.duration = (section.cpuEnd - section.cpuBegin) * 1.0e6;
+			events.push_back(event);
+
+			event.track = 2;
+			event.start = (gpuBegin * 1.0e-9 + frame.offset - origin) * 1.0e6;
+			event.duration = gpuEnd > gpuBegin ? (gpuEnd - gpuBegin) * 1.0e-3 : 0.0;
+			events.push_back(event);
+		}
+		frame.pending = false;
+	}
+
+	bool writeTrace(const std::string &path)
+	{
+		FILE *file = std::fopen(path.c_str(), "w");
+		if (file == NULL)
+			return false;
+		std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+		std::fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n");
+		std::fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+		for (unsigned int e = 0; e < events.size(); e++)
+		{
+			const TraceEvent &event = events[e];
+			std::string name;
+			for (unsigned int c = 0; c < event.name.size(); c++)
+			{
+				if (event.name[c] == '"' || event.name[c] == '\\')
+					name += '\\';
+				name += event.name[c];
+			}
+			std::fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u}}",
+				name.c_str(), event.track, event.start, event.duration, event.frame);
+		}
+		std::fprintf(file, "\n]}\n");
+		return std::fclose(file) == 0;
+	}
+
+	Profiler(const Profiler&);
+	Profiler &operator=(const Profiler&);
+};
+
+// Times the enclosing block as a section of the current frame
+class ProfileScope
+{
+public:
+	ProfileScope(Profiler &p, const char *name) : profiler(p)
+	{
+		profiler.begin(name);
+	}
+
+	~ProfileScope()
+	{
+		profiler.end();
+	}
+
+private:
+	Profiler &profiler;
+};
+
+#endif
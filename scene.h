@@ -0,0 +1,530 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <shader_m.h>
+#include <staticmodel.h>
+#include <instancing.h>
+#include <uniforms.h>
+#include <bounds.h>
+#include <culling.h>
+#include <bvh.h>
+#include <lod.h>
+#include <jobs.h>
+#include <transforms.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Per-entry flags
+enum Scene_Flags {
+	SCENE_NONE   = 0,
+	SCENE_HIDDEN = 1 << 0,	// Entry still transforms its children but is not drawn
+	SCENE_INSTANCED = 1 << 1,	// Entry is drawn in one instanced batch with the other copies of its model
+	SCENE_DYNAMIC = 1 << 2		// Entry (and everything below it) moves every frame
+};
+
+// Builds a rotation from an angle in degrees and a unit axis, same convention as glm::rotate
+inline glm::quat axisAngle(float degrees, glm::vec3 axis)
+{
+	return glm::angleAxis(glm::radians(degrees), axis);
+}
+
+// A flat table of scene objects stored as parallel arrays and walked by a single loop.
+// Every entry is placed as Translate * Rotate * Scale relative to its parent (or to the root
+// transform when it has none). Entries must be added after their parent so one forward pass
+// resolves all world matrices. Entries without a model (-1) act as pivots for their children.
+// World matrices are cached: only entries changed through the setters, their descendants, or
+// every entry when the root transform changes, are rebuilt by update(). The setters are meant to
+// be called once per simulation step, after step(); update() then blends every moving entry
+// between its last two steps so motion stays smooth at any frame rate. Entries whose world box
+// falls outside the frustum given to cull() are skipped by draw().
+// Drawable entries are indexed by two BVHs: the static one is rebuilt only when a static entry
+// moves (e.g. the isometric toggle), the dynamic one only holds SCENE_DYNAMIC entries and their
+// children and is refitted after every update that moved them.
+// Non instanced entries are drawn at the detail level selectLod() picks from their size on screen.
+// Models may still be loading (or be streamed out) when their entries are added; refresh() picks
+// them up as they come and go.
+// Between update() and drawing, cull(), selectLod() and prepareDraw() only touch CPU data and
+// prepare() adds them to a JobSystem, so the thread owning the GL context is left with the draw
+// calls of drawGroup() and drawInstanced().
+class Scene
+{
+public:
+	// Named groups of entries, drawn separately by drawGroup()
+	std::vector<std::string> groupNames;
+	unsigned int currentGroup = 0;
+
+	// Model handles referenced by the entries
+	std::vector<StaticModel*> models;
+	std::vector<int> batchOf;	// Instanced batch of each handle, -1 if it has none
+	std::vector<InstancedModel> batches;
+	std::vector<Bounds> bounds;	// Local bounds of each handle, read from its model once it is loaded
+	std::vector<unsigned char> loaded;	// Whether the model of each handle had geometry at the last refresh()
+
+	// Entry attributes
+	std::vector<int> model;
+	std::vector<glm::vec3> position;
+	std::vector<glm::quat> rotation;
+	std::vector<glm::vec3> scale;
+	std::vector<glm::vec3> lastPosition;	// Local transform at the previous simulation step
+	std::vector<glm::quat> lastRotation;
+	std::vector<glm::vec3> lastScale;
+	std::vector<int> parent;
+	std::vector<unsigned int> flags;
+	std::vector<unsigned int> group;
+	std::vector<glm::mat4> local;		// Local matrix, kept for the entries rebuilt by the last update
+	std::vector<glm::mat4> world;
+	BoxArrays worldBox;
+	std::vector<unsigned char> visible;
+	std::vector<unsigned char> dynamic;	// SCENE_DYNAMIC or child of a dynamic entry
+	std::vector<unsigned char> lod;		// Detail level drawn, kept between frames for the hysteresis
+
+	// Draw lists filled by prepareDraw(): drawable non instanced entries per group
+	std::vector<std::vector<int> > packets;
+
+	// Spatial index
+	BVH staticTree;
+	BVH dynamicTree;
+	bool indexBuilt = false;
+
+	// Cache state
+	std::vector<unsigned char> dirty;	// Local transform changed since the last update
+	std::vector<unsigned char> rebuilt;	// World matrix was rebuilt during the last update
+	std::vector<unsigned int> changed;	// Entries rebuilt by the last update, parents first
+	glm::mat4 rootTransform = glm::mat4(1.0f);
+
+	// Returns the handle of a model, registering it the first time it is seen
+	int handle(StaticModel &m)
+	{
+		for (unsigned int i = 0; i < models.size(); i++)
+			if (models[i] == &m)
+				return i;
+		models.push_back(&m);
+		batchOf.push_back(-1);
+		bounds.push_back(m.bounds);
+		loaded.push_back(m.levels() > 0);
+		return (int)models.size() - 1;
+	}
+
+	// Entries added from now on belong to the named group, which is created the first time it is
+	// used (entries added before the first call end up in the first group). Returns its index.
+	int useGroup(const std::string &name)
+	{
+		unsigned int g = 0;
+		while (g < groupNames.size() && groupNames[g] != name)
+			g++;
+		if (g == groupNames.size())
+			groupNames.push_back(name);
+		currentGroup = g;
+		return (int)g;
+	}
+
+	// Adds a pivot without geometry and returns its index
+	int add(glm::vec3 pos, float scl = 1.0f, glm::quat rot = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), int parentIndex = -1, unsigned int entryFlags = SCENE_NONE)
+	{
+		model.push_back(-1);
+		position.push_back(pos);
+		rotation.push_back(rot);
+		scale.push_back(glm::vec3(scl));
+		lastPosition.push_back(pos);
+		lastRotation.push_back(rot);
+		lastScale.push_back(glm::vec3(scl));
+		parent.push_back(parentIndex);
+		flags.push_back(entryFlags);
+		group.push_back(currentGroup);
+		local.push_back(glm::mat4(1.0f));
+		world.push_back(glm::mat4(1.0f));
+		dirty.push_back(1);
+		rebuilt.push_back(0);
+		worldBox.push();
+		visible.push_back(1);
+		lod.push_back(0);
+		dynamic.push_back((entryFlags & SCENE_DYNAMIC) || (parentIndex >= 0 && dynamic[parentIndex]));
+		indexBuilt = false;
+		return (int)model.size() - 1;
+	}
+
+	// Adds an object drawn with the given model and returns its index.
+	// Instanced entries need a current GL context, their batch buffer is created here.
+	int add(StaticModel &m, glm::vec3 pos, float scl = 1.0f, glm::quat rot = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), int parentIndex = -1, unsigned int entryFlags = SCENE_NONE)
+	{
+		int index = add(pos, scl, rot, parentIndex, entryFlags);
+		int h = handle(m);
+		model[index] = h;
+		if ((entryFlags & SCENE_INSTANCED) && batchOf[h] < 0)
+		{
+			batches.push_back(InstancedModel(m));
+			batches.back().setup();
+			batchOf[h] = (int)batches.size() - 1;
+		}
+		return index;
+	}
+
+	// Adds a copy of an entry (model, transform, flags and group) under parentIndex and returns
+	// its index. A copy of an instanced entry joins the batch of the original.
+	int duplicate(int index, int parentIndex)
+	{
+		int copy = add(position[index], 1.0f, rotation[index], parentIndex, flags[index]);
+		model[copy] = model[index];
+		scale[copy] = lastScale[copy] = scale[index];
+		group[copy] = group[index];
+		return copy;
+	}
+
+	// Picks up the models that were uploaded or released since the last call. A model that arrives
+	// gives its bounds to its entries and its vertex arrays to its batch, a released one is simply
+	// skipped by draw() until it comes back. Call it before update().
+	// Returns how many models changed.
+	unsigned int refresh()
+	{
+		unsigned int changed = 0;
+		for (unsigned int h = 0; h < models.size(); h++)
+		{
+			bool now = models[h]->levels() > 0;
+			if (now == (loaded[h] != 0))
+				continue;
+			loaded[h] = now;
+			changed++;
+			if (!now)
+				continue;
+
+			bounds[h] = models[h]->bounds;
+			if (batchOf[h] >= 0)
+				batches[batchOf[h]].attach();
+			for (unsigned int i = 0; i < model.size(); i++)
+				if (model[i] == (int)h)
+					dirty[i] = 1;
+		}
+		return changed;
+	}
+
+	// Setters only invalidate the cached matrix when the value actually changes
+	void setPosition(int index, const glm::vec3 &pos)
+	{
+		if (position[index] != pos) {
+			position[index] = pos;
+			dirty[index] = 1;
+		}
+	}
+
+	void setRotation(int index, const glm::quat &rot)
+	{
+		if (rotation[index] != rot) {
+			rotation[index] = rot;
+			dirty[index] = 1;
+		}
+	}
+
+	void setScale(int index, const glm::vec3 &scl)
+	{
+		if (scale[index] != scl) {
+			scale[index] = scl;
+			dirty[index] = 1;
+		}
+	}
+
+	// Starts a simulation step: the current transforms become the previous ones, which update()
+	// blends from. Entries that were still blending are rebuilt once more so they land exactly
+	// on their final transform.
+	void step()
+	{
+		for (unsigned int i = 0; i < model.size(); i++)
+		{
+			if (!blending(i))
+				continue;
+			lastPosition[i] = position[i];
+			lastRotation[i] = rotation[i];
+			lastScale[i] = scale[i];
+			dirty[i] = 1;
+		}
+	}
+
+	// Makes an entry jump to its current transform instead of blending from the previous step,
+	// for entries driven every frame (such as the ones following the camera) or teleported
+	void snap(int index)
+	{
+		if (!blending(index))
+			return;
+		lastPosition[index] = position[index];
+		lastRotation[index] = rotation[index];
+		lastScale[index] = scale[index];
+		dirty[index] = 1;
+	}
+
+	unsigned int size() const
+	{
+		return (unsigned int)model.size();
+	}
+
+	// Resolves the world matrices that are out of date. Root entries are placed relative to root,
+	// which carries the isometric pre-transform when that camera mode is active. Entries that moved
+	// during the last simulation step are drawn alpha of the way from their previous transform to
+	// the current one, and are rebuilt every frame until the next step.
+	// The local matrices of the entries to rebuild do not depend on each other, with jobs they are
+	// built in ranges on every thread before the world matrices are chained in order. Unlike
+	// prepare() this runs the graph itself, so call it while the graph of jobs is empty.
+	// Returns how many matrices were rebuilt.
+	unsigned int update(const glm::mat4 &root, float alpha = 1.0f, JobSystem *jobs = NULL)
+	{
+		bool rootChanged = root != rootTransform;
+		rootTransform = root;
+
+		changed.clear();
+		for (unsigned int i = 0; i < model.size(); i++)
+		{
+			bool parentChanged = parent[i] < 0 ? rootChanged : rebuilt[parent[i]] != 0;
+			rebuilt[i] = dirty[i] || parentChanged || (alpha < 1.0f && blending(i));
+			if (rebuilt[i])
+				changed.push_back(i);
+		}
+
+		if (jobs != NULL)
+		{
+			jobs->parallelFor((unsigned int)changed.size(), 64, [this, alpha](unsigned int begin, unsigned int end) { buildLocal(begin, end, alpha); });
+			jobs->run();
+		}
+		else
+			buildLocal(0, (unsigned int)changed.size(), alpha);
+
+		if (!changed.empty())
+			multiplyChain(&parent[0], root, &local[0], &changed[0], (unsigned int)changed.size(), &world[0]);
+
+		bool staticMoved = false, dynamicMoved = false;
+		for (unsigned int c = 0; c < changed.size(); c++)
+		{
+			unsigned int i = changed[c];
+			if (model[i] >= 0)
+			{
+				worldBox.set(i, bounds[model[i]], world[i]);
+				if (dynamic[i])
+					dynamicMoved = true;
+				else
+					staticMoved = true;
+			}
+			dirty[i] = 0;
+		}
+
+		if (!indexBuilt)
+			buildIndex();
+		else
+		{
+			if (staticMoved)
+				staticTree.rebuild(worldBox);
+			if (dynamicMoved)
+				dynamicTree.refit(worldBox);
+		}
+		return (unsigned int)changed.size();
+	}
+
+	// Appends the drawable entries whose world box overlaps [min, max]
+	void queryBox(const glm::vec3 &min, const glm::vec3 &max, std::vector<int> &out) const
+	{
+		staticTree.queryBox(min, max, out);
+		dynamicTree.queryBox(min, max, out);
+	}
+
+	// Appends the drawable entries whose world box is within radius of center
+	void querySphere(const glm::vec3 &center, float radius, std::vector<int> &out) const
+	{
+		staticTree.querySphere(center, radius, out);
+		dynamicTree.querySphere(center, radius, out);
+	}
+
+	// Returns the first drawable entry hit by the ray, or -1
+	int raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance = 1.0e30f) const
+	{
+		float distance = maxDistance;
+		int hit = staticTree.raycast(origin, direction, distance);
+		int dynamicHit = dynamicTree.raycast(origin, direction, distance);
+		return dynamicHit >= 0 ? dynamicHit : hit;
+	}
+
+	// Marks the entries whose world box touches the frustum, call it after update()
+	void cull(const Frustum &frustum)
+	{
+		if (visible.empty())
+			return;
+		std::fill(visible.begin(), visible.end(), 0);
+		staticTree.cull(frustum, &visible[0]);
+		dynamicTree.cull(frustum, &visible[0]);
+	}
+
+	// Chooses the detail level of every visible entry, call it after cull(). The size on screen is
+	// the world bounding sphere seen through a perspective projection from eye.
+	void selectLod(const glm::vec3 &eye, const glm::mat4 &projection)
+	{
+		selectLod(eye, projection, 0, size());
+	}
+
+	// Fills the draw lists of drawGroup() and drawInstanced(), call it after cull()
+	void prepareDraw()
+	{
+		buildPackets();
+		gatherInstances();
+	}
+
+	// Adds cull(), selectLod() and prepareDraw() to jobs, all starting after the given job: both
+	// trees are culled side by side, then the detail levels are chosen in ranges of grain entries
+	// while the draw lists are filled. Returns the job finishing them, the caller runs the graph.
+	Job prepare(JobSystem &jobs, const Frustum &frustum, const glm::vec3 &eye, const glm::mat4 &projection, unsigned int grain = 256, Job after = NO_JOB)
+	{
+		if (visible.empty())
+			return jobs.add(std::function<void()>(), after);
+		std::fill(visible.begin(), visible.end(), 0);
+		Job staticCulled = jobs.add([this, frustum]() { staticTree.cull(frustum, &visible[0]); }, after);
+		Job dynamicCulled = jobs.add([this, frustum]() { dynamicTree.cull(frustum, &visible[0]); }, after);
+		Job culled = jobs.add(std::function<void()>(), staticCulled);
+		jobs.depend(culled, dynamicCulled);
+		Job detailed = jobs.parallelFor(size(), grain, [this, eye, projection](unsigned int begin, unsigned int end) { selectLod(eye, projection, begin, end); }, culled);
+		Job packed = jobs.add([this]() { buildPackets(); }, culled);
+		Job gathered = jobs.add([this]() { gatherInstances(); }, culled);
+		Job done = jobs.add(std::function<void()>(), detailed);
+		jobs.depend(done, packed);
+		jobs.depend(done, gathered);
+		return done;
+	}
+
+	// Draws every visible entry that has a model. Instanced entries are gathered per model
+	// and drawn afterwards with the instanced program, which reads the model matrix per instance.
+	void draw(UniformCache &uniforms, UniformCache &instanced)
+	{
+		prepareDraw();
+		drawGroup(uniforms, -1);
+		drawInstanced(instanced);
+	}
+
+	// Draws the visible entries of one group that are not instanced, or of every group with -1.
+	// Uses the lists of the last prepareDraw().
+	void drawGroup(UniformCache &uniforms, int g)
+	{
+		for (unsigned int p = 0; p < packets.size(); p++)
+		{
+			if (g >= 0 && p != (unsigned int)g)
+				continue;
+			for (unsigned int k = 0; k < packets[p].size(); k++)
+			{
+				int i = packets[p][k];
+				uniforms.setMat4(Uniform::model, world[i]);
+				models[model[i]]->Draw(uniforms, lod[i]);
+			}
+		}
+	}
+
+	// Draws the instanced entries of every group, one draw call per mesh of each batch. Uses the
+	// matrices of the last prepareDraw().
+	void drawInstanced(UniformCache &instanced)
+	{
+		if (batches.empty())
+			return;
+		instanced.use();
+		for (unsigned int b = 0; b < batches.size(); b++)
+			batches[b].Draw(instanced);
+	}
+
+	bool drawable(unsigned int i) const
+	{
+		return model[i] >= 0 && !(flags[i] & SCENE_HIDDEN) && visible[i] && loaded[model[i]];
+	}
+
+	// Whether the model of the entry is in memory, entries of streamed out regions are not
+	bool resident(unsigned int i) const
+	{
+		return model[i] >= 0 && loaded[model[i]];
+	}
+
+	// Whether the entry moved during the last simulation step
+	bool blending(unsigned int i) const
+	{
+		return position[i] != lastPosition[i] || rotation[i] != lastRotation[i] || scale[i] != lastScale[i];
+	}
+
+	// Splits the drawable entries between the two trees and builds both
+	void buildIndex()
+	{
+		std::vector<int> staticEntries, dynamicEntries;
+		for (unsigned int i = 0; i < model.size(); i++)
+		{
+			if (model[i] < 0)
+				continue;
+			if (dynamic[i])
+				dynamicEntries.push_back(i);
+			else
+				staticEntries.push_back(i);
+		}
+		staticTree.build(staticEntries, worldBox);
+		dynamicTree.build(dynamicEntries, worldBox);
+		indexBuilt = true;
+	}
+
+	// Builds the local matrices of changed[begin, end). Runs of entries at their current transform
+	// go through the batched kernel, blended entries are composed one by one.
+	void buildLocal(unsigned int begin, unsigned int end, float alpha)
+	{
+		unsigned int c = begin;
+		while (c < end)
+		{
+			unsigned int run = c;
+			while (run < end && !(alpha < 1.0f && blending(changed[run])))
+				run++;
+			composeTRS(&position[0], &rotation[0], &scale[0], &changed[c], run - c, &local[0]);
+			if (run == end)
+				break;
+
+			unsigned int i = changed[run];
+			// A turn of more than 90 degrees in one step is an animation wrapping around its
+			// angle (the rings go from 180 back to 0), it is not blended the short way
+			glm::quat rot = glm::abs(glm::dot(lastRotation[i], rotation[i])) < 0.7071f ? rotation[i] : glm::slerp(lastRotation[i], rotation[i], alpha);
+			composeTRS(glm::mix(lastPosition[i], position[i], alpha), rot, glm::mix(lastScale[i], scale[i], alpha), local[i]);
+			c = run + 1;
+		}
+	}
+
+	// Detail level of the visible entries in [begin, end)
+	void selectLod(const glm::vec3 &eye, const glm::mat4 &projection, unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			if (model[i] < 0 || !visible[i] || models[model[i]]->levels() < 2)
+				continue;
+			const glm::mat4 &m = world[i];
+			float scl = glm::max(glm::length(glm::vec3(m[0])), glm::max(glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2]))));
+			float radius = bounds[model[i]].radius * scl;
+			float distance = glm::length(glm::vec3(worldBox.cx[i], worldBox.cy[i], worldBox.cz[i]) - eye);
+			float size = distance > radius ? radius * projection[1][1] / distance : 1.0e30f;
+			lod[i] = (unsigned char)::selectLod(size, lod[i], models[model[i]]->levels());
+		}
+	}
+
+	void buildPackets()
+	{
+		packets.resize(std::max<size_t>(groupNames.size(), 1));
+		for (unsigned int p = 0; p < packets.size(); p++)
+			packets[p].clear();
+		for (unsigned int i = 0; i < model.size(); i++)
+			if (drawable(i) && !(flags[i] & SCENE_INSTANCED))
+				packets[group[i]].push_back(i);
+	}
+
+	void gatherInstances()
+	{
+		for (unsigned int b = 0; b < batches.size(); b++)
+			batches[b].instances.clear();
+		for (unsigned int i = 0; i < model.size(); i++)
+			if (drawable(i) && (flags[i] & SCENE_INSTANCED))
+				batches[batchOf[model[i]]].instances.push_back(world[i]);
+	}
+
+	void Terminate()
+	{
+		for (unsigned int b = 0; b < batches.size(); b++)
+			batches[b].Terminate();
+	}
+};
+
+#endif
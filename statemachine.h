@@ -0,0 +1,267 @@
+#ifndef STATEMACHINE_H
+#define STATEMACHINE_H
+
+#include <cmath>
+#include <vector>
+
+// How a channel is compared with a threshold
+enum MachineCompare
+{
+	MACHINE_AT_LEAST,	// channel >= threshold
+	MACHINE_AT_MOST		// channel <= threshold
+};
+
+// channel = offset + amplitude * cos(source) (or sin), from the values before the step
+struct MachineWave
+{
+	unsigned int channel;
+	unsigned int source;
+	float offset;
+	float amplitude;
+	bool cosine;
+};
+
+// Once the channel passes the threshold it is set to value (a clamp, or a wrap around)
+struct MachineLimit
+{
+	unsigned int channel;
+	MachineCompare compare;
+	float threshold;
+	float value;
+};
+
+// Once the channel passes the threshold the machine moves to next, optionally setting the channel
+struct MachineTransition
+{
+	unsigned int channel;
+	MachineCompare compare;
+	float threshold;
+	unsigned int next;
+	bool set;
+	float value;
+};
+
+struct MachineState
+{
+	std::vector<float> rates;		// Added to each channel every step
+	std::vector<MachineWave> waves;
+	std::vector<MachineLimit> limits;
+	std::vector<MachineTransition> transitions;
+};
+
+// Description of an animation as data: a set of float channels and states that change them.
+// Every step, in this order, a state computes its waves, adds its rate to every channel, applies
+// its limits and takes the first transition whose condition holds.
+class StateMachineDef
+{
+public:
+	explicit StateMachineDef(unsigned int channels) : channelCount(channels)
+	{
+	}
+
+	// Adds a state that changes nothing and returns its index
+	unsigned int addState()
+	{
+		MachineState state;
+		state.rates.assign(channelCount, 0.0f);
+		definition.push_back(state);
+		return (unsigned int)definition.size() - 1;
+	}
+
+	void setRate(unsigned int state, unsigned int channel, float perStep)
+	{
+		definition[state].rates[channel] = perStep;
+	}
+
+	void addWave(unsigned int state, unsigned int channel, unsigned int source, float offset, float amplitude, bool cosine)
+	{
+		MachineWave wave = { channel, source, offset, amplitude, cosine };
+		definition[state].waves.push_back(wave);
+	}
+
+	void addLimit(unsigned int state, unsigned int channel, MachineCompare compare, float threshold, float value)
+	{
+		MachineLimit limit = { channel, compare, threshold, value };
+		definition[state].limits.push_back(limit);
+	}
+
+	void addTransition(unsigned int state, unsigned int channel, MachineCompare compare, float threshold, unsigned int next)
+	{
+		MachineTransition transition = { channel, compare, threshold, next, false, 0.0f };
+		definition[state].transitions.push_back(transition);
+	}
+
+	// Transition that also sets the channel to value, e.g. to land exactly on the threshold
+	void addTransition(unsigned int state, unsigned int channel, MachineCompare compare, float threshold, unsigned int next, float value)
+	{
+		MachineTransition transition = { channel, compare, threshold, next, true, value };
+		definition[state].transitions.push_back(transition);
+	}
+
+	unsigned int channels() const
+	{
+		return channelCount;
+	}
+
+	unsigned int states() const
+	{
+		return (unsigned int)definition.size();
+	}
+
+	const MachineState &state(unsigned int index) const
+	{
+		return definition[index];
+	}
+
+private:
+	unsigned int channelCount;
+	std::vector<MachineState> definition;
+};
+
+// Actors running the same StateMachineDef, kept as structure of arrays: every channel is one
+// contiguous array over all the actors, and so is the rate each actor's state gives it. The rates
+// are copied when an actor changes state, so the bulk of a step is one loop per channel adding
+// two arrays, which the compiler vectorizes; waves, limits and transitions only look at the few
+// values they name.
+class StateMachinePool
+{
+public:
+	// The definition must outlive the pool
+	explicit StateMachinePool(const StateMachineDef &machine) : definition(&machine), values(machine.channels()), rates(machine.channels())
+	{
+	}
+
+	// Adds an actor with its channels at initial and returns its index
+	int spawn(const float *initial, unsigned int state = 0)
+	{
+		for (unsigned int c = 0; c < values.size(); c++)
+		{
+			values[c].push_back(initial[c]);
+			rates[c].push_back(0.0f);
+		}
+		states.push_back(state);
+		enabled.push_back(1);
+		int actor = (int)states.size() - 1;
+		enter(actor, state);
+		return actor;
+	}
+
+	unsigned int size() const
+	{
+		return (unsigned int)states.size();
+	}
+
+	// A disabled actor keeps its values and state until enabled again
+	void setEnabled(int actor, bool on)
+	{
+		if ((enabled[actor] != 0) == on)
+			return;
+		enabled[actor] = on ? 1 : 0;
+		enter(actor, states[actor]);
+	}
+
+	bool isEnabled(int actor) const
+	{
+		return enabled[actor] != 0;
+	}
+
+	unsigned int state(int actor) const
+	{
+		return states[actor];
+	}
+
+	void setState(int actor, unsigned int state)
+	{
+		enter(actor, state);
+	}
+
+	float value(int actor, unsigned int channel) const
+	{
+		return values[channel][actor];
+	}
+
+	void setValue(int actor, unsigned int channel, float value)
+	{
+		values[channel][actor] = value;
+	}
+
+	// Values of one channel for every actor
+	const float *channel(unsigned int c) const
+	{
+		return values[c].empty() ? NULL : &values[c][0];
+	}
+
+	// Advances every enabled actor one step
+	void step()
+	{
+		unsigned int count = size();
+		if (count == 0)
+			return;
+
+		for (unsigned int a = 0; a < count; a++)
+		{
+			if (!enabled[a])
+				continue;
+			const std::vector<MachineWave> &waves = definition->state(states[a]).waves;
+			for (unsigned int w = 0; w < waves.size(); w++)
+			{
+				const MachineWave &wave = waves[w];
+				float angle = values[wave.source][a];
+				values[wave.channel][a] = wave.offset + wave.amplitude * (wave.cosine ? std::cos(angle) : std::sin(angle));
+			}
+		}
+
+		for (unsigned int c = 0; c < values.size(); c++)
+		{
+			float *value = &values[c][0];
+			const float *rate = &rates[c][0];
+			for (unsigned int a = 0; a < count; a++)
+				value[a] += rate[a];
+		}
+
+		for (unsigned int a = 0; a < count; a++)
+		{
+			if (!enabled[a])
+				continue;
+			const MachineState &state = definition->state(states[a]);
+			for (unsigned int l = 0; l < state.limits.size(); l++)
+			{
+				const MachineLimit &limit = state.limits[l];
+				if (passed(values[limit.channel][a], limit.compare, limit.threshold))
+					values[limit.channel][a] = limit.value;
+			}
+			for (unsigned int t = 0; t < state.transitions.size(); t++)
+			{
+				const MachineTransition &transition = state.transitions[t];
+				if (!passed(values[transition.channel][a], transition.compare, transition.threshold))
+					continue;
+				if (transition.set)
+					values[transition.channel][a] = transition.value;
+				enter(a, transition.next);
+				break;
+			}
+		}
+	}
+
+private:
+	const StateMachineDef *definition;
+	std::vector<std::vector<float> > values;	// [channel][actor]
+	std::vector<std::vector<float> > rates;		// [channel][actor], 0 while disabled
+	std::vector<unsigned int> states;
+	std::vector<unsigned char> enabled;
+
+	static bool passed(float value, MachineCompare compare, float threshold)
+	{
+		return compare == MACHINE_AT_LEAST ? value >= threshold : value <= threshold;
+	}
+
+	void enter(int actor, unsigned int state)
+	{
+		states[actor] = state;
+		const std::vector<float> &stateRates = definition->state(state).rates;
+		for (unsigned int c = 0; c < rates.size(); c++)
+			rates[c][actor] = enabled[actor] ? stateRates[c] : 0.0f;
+	}
+};
+
+#endif
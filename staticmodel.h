@@ -0,0 +1,189 @@
+#ifndef STATICMODEL_H
+#define STATICMODEL_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <mesh.h>
+#include <bounds.h>
+#include <meshcache.h>
+#include <uniforms.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Sampler keys for the texture naming used by Mesh::Draw (texture_diffuse1, texture_specular1, ...)
+const unsigned int MAX_TEXTURES_PER_TYPE = 4;
+constexpr UniformKey TEXTURE_KEYS[4][MAX_TEXTURES_PER_TYPE] = {
+	{ "texture_diffuse1", "texture_diffuse2", "texture_diffuse3", "texture_diffuse4" },
+	{ "texture_specular1", "texture_specular2", "texture_specular3", "texture_specular4" },
+	{ "texture_normal1", "texture_normal2", "texture_normal3", "texture_normal4" },
+	{ "texture_height1", "texture_height2", "texture_height3", "texture_height4" }
+};
+
+// Resolves the sampler key of every texture of a mesh (NULL past MAX_TEXTURES_PER_TYPE) so
+// drawing never touches the texture type strings
+inline void samplerKeys(const std::vector<Texture> &textures, std::vector<const UniformKey*> &keys)
+{
+	const char *types[4] = { "texture_diffuse", "texture_specular", "texture_normal", "texture_height" };
+	unsigned int count[4] = { 0, 0, 0, 0 };
+	keys.clear();
+	for (unsigned int t = 0; t < textures.size(); t++)
+	{
+		const UniformKey *key = NULL;
+		for (unsigned int k = 0; k < 4; k++)
+			if (textures[t].type == types[k] && count[k] < MAX_TEXTURES_PER_TYPE)
+				key = &TEXTURE_KEYS[k][count[k]++];
+		keys.push_back(key);
+	}
+}
+
+// Binds the textures of a mesh the same way Mesh::Draw does
+inline void bindTextures(const std::vector<Texture> &textures, const std::vector<const UniformKey*> &keys, UniformCache &uniforms)
+{
+	for (unsigned int t = 0; t < textures.size(); t++)
+	{
+		glActiveTexture(GL_TEXTURE0 + t);
+		if (keys[t] != NULL)
+			uniforms.setInt(*keys[t], t);
+		glBindTexture(GL_TEXTURE_2D, textures[t].id);
+	}
+}
+
+// Draw calls and triangles submitted by StaticModel and InstancedModel since the last reset,
+// for the benchmark report
+struct DrawCounters
+{
+	unsigned int calls;
+	unsigned long long triangles;
+};
+
+inline DrawCounters &drawCounters()
+{
+	static DrawCounters counters = { 0, 0 };
+	return counters;
+}
+
+// A mesh of one detail level, drawn from the shared buffers of its model
+struct StaticMesh
+{
+	unsigned int VAO;
+	unsigned int firstIndex;
+	unsigned int indexCount;
+	std::vector<Texture> textures;
+	std::vector<const UniformKey*> samplers;
+};
+
+// Model loaded through the binary mesh cache. All the vertices of every level live in one
+// vertex buffer and all the indices in one index buffer, each mesh only owns a vertex array
+// pointing at its range. Nothing is kept on the CPU after the upload. Textures belong to
+// whoever created them (see AssetLoader), the model only references them.
+class StaticModel
+{
+public:
+	std::vector<StaticMesh> meshes;		// Every level, sorted by level
+	std::vector<unsigned int> levelStart;	// Meshes of level l are [levelStart[l], levelStart[l + 1])
+	std::string directory;
+	Bounds bounds;
+
+	StaticModel() : VBO(0), EBO(0)
+	{
+	}
+
+	unsigned int levels() const
+	{
+		return levelStart.empty() ? 0 : (unsigned int)levelStart.size() - 1;
+	}
+
+	// Creates the buffers and vertex arrays of the model on the GL thread. textureIds holds the
+	// texture of every entry of data.textures.
+	void upload(const ModelData &data, const std::vector<unsigned int> &textureIds)
+	{
+		directory = data.directory;
+		bounds = data.bounds;
+		if (data.vertexCount == 0 || data.indexCount == 0)
+			return;
+
+		glGenBuffers(1, &VBO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, data.vertexCount * sizeof(Vertex), data.vertices, GL_STATIC_DRAW);
+		glGenBuffers(1, &EBO);
+
+		levelStart.assign(1, 0);
+		for (unsigned int m = 0; m < data.meshes.size(); m++)
+		{
+			const MeshRecord &record = data.meshes[m];
+			while (levelStart.size() <= record.level)
+				levelStart.push_back(m);
+
+			StaticMesh mesh;
+			mesh.firstIndex = record.firstIndex;
+			mesh.indexCount = record.indexCount;
+			for (unsigned int t = record.firstTexture; t < record.firstTexture + record.textureCount; t++)
+			{
+				Texture texture;
+				texture.id = textureIds[t];
+				texture.type = data.textures[t].type;
+				texture.path = data.textures[t].path;
+				mesh.textures.push_back(texture);
+			}
+			samplerKeys(mesh.textures, mesh.samplers);
+
+			glGenVertexArrays(1, &mesh.VAO);
+			glBindVertexArray(mesh.VAO);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+			if (m == 0)
+				glBufferData(GL_ELEMENT_ARRAY_BUFFER, data.indexCount * sizeof(unsigned int), data.indices, GL_STATIC_DRAW);
+			size_t base = record.firstVertex * sizeof(Vertex);
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(base + offsetof(Vertex, Position)));
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(base + offsetof(Vertex, Normal)));
+			glEnableVertexAttribArray(2);
+			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(base + offsetof(Vertex, TexCoords)));
+			glEnableVertexAttribArray(3);
+			glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(base + offsetof(Vertex, Tangent)));
+			glEnableVertexAttribArray(4);
+			glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(base + offsetof(Vertex, Bitangent)));
+			meshes.push_back(mesh);
+		}
+		levelStart.push_back((unsigned int)meshes.size());
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	// Binds the textures the same way Mesh::Draw does and draws every mesh of the level
+	void Draw(UniformCache &uniforms, unsigned int level = 0)
+	{
+		if (level >= levels())
+			return;
+		for (unsigned int i = levelStart[level]; i < levelStart[level + 1]; i++)
+		{
+			StaticMesh &mesh = meshes[i];
+			bindTextures(mesh.textures, mesh.samplers, uniforms);
+			glBindVertexArray(mesh.VAO);
+			glDrawElements(GL_TRIANGLES, (GLsizei)mesh.indexCount, GL_UNSIGNED_INT, (void*)(mesh.firstIndex * sizeof(unsigned int)));
+			glBindVertexArray(0);
+			drawCounters().calls++;
+			drawCounters().triangles += mesh.indexCount / 3;
+			glActiveTexture(GL_TEXTURE0);
+		}
+	}
+
+	void Terminate()
+	{
+		for (unsigned int i = 0; i < meshes.size(); i++)
+			glDeleteVertexArrays(1, &meshes[i].VAO);
+		glDeleteBuffers(1, &VBO);
+		glDeleteBuffers(1, &EBO);
+		meshes.clear();
+		levelStart.clear();
+		VBO = EBO = 0;
+	}
+
+private:
+	unsigned int VBO, EBO;
+};
+
+#endif
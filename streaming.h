@@ -0,0 +1,115 @@
+#ifndef STREAMING_H
+#define STREAMING_H
+
+#include <glm/glm.hpp>
+
+#include <assets.h>
+#include <staticmodel.h>
+
+#include <string>
+#include <vector>
+
+// A box of the scene whose models are only kept in memory while the camera is near it
+struct StreamRegion
+{
+	glm::vec3 min;
+	glm::vec3 max;
+	std::vector<std::string> paths;
+	std::vector<StaticModel*> held;	// References taken from the loader while resident
+	bool resident;
+};
+
+// Loads the models of a region when the camera comes within loadDistance of its box and releases
+// them once it is farther than unloadDistance. The gap between both distances keeps a camera
+// moving along the border from loading and evicting the same region every frame.
+// Models are requested through an AssetLoader, so they arrive asynchronously and a model shared
+// with another region (or held by someone else) stays resident until its last user lets it go.
+class RegionStreamer
+{
+public:
+	float loadDistance;
+	float unloadDistance;
+
+	RegionStreamer(AssetLoader &assets, float load = 100.0f, float unload = 160.0f) : loadDistance(load), unloadDistance(unload), loader(&assets)
+	{
+	}
+
+	// Adds a region given by its box in scene space and returns its index
+	int addRegion(const glm::vec3 &min, const glm::vec3 &max)
+	{
+		StreamRegion region;
+		region.min = min;
+		region.max = max;
+		region.resident = false;
+		regions.push_back(region);
+		return (int)regions.size() - 1;
+	}
+
+	// Registers a model of the region and returns it without loading it. The returned model
+	// can be added to the scene right away, it draws nothing while the region is away.
+	StaticModel &model(int region, const std::string &path)
+	{
+		regions[region].paths.push_back(path);
+		return loader->reserve(path);
+	}
+
+	// Loads or releases regions according to their distance to eye. root is the transform the
+	// scene is drawn with, the regions are moved by it before measuring.
+	// Returns how many regions changed state.
+	unsigned int update(const glm::vec3 &eye, const glm::mat4 &root = glm::mat4(1.0f))
+	{
+		glm::vec3 local = glm::vec3(glm::inverse(root) * glm::vec4(eye, 1.0f));
+		unsigned int changed = 0;
+		for (unsigned int r = 0; r < regions.size(); r++)
+		{
+			StreamRegion &region = regions[r];
+			float distance = glm::length(local - glm::clamp(local, region.min, region.max));
+			if (!region.resident && distance < loadDistance)
+				load(region);
+			else if (region.resident && distance > unloadDistance)
+				unload(region);
+			else
+				continue;
+			changed++;
+		}
+		return changed;
+	}
+
+	bool resident(int region) const
+	{
+		return regions[region].resident;
+	}
+
+	unsigned int size() const
+	{
+		return (unsigned int)regions.size();
+	}
+
+	void Terminate()
+	{
+		for (unsigned int r = 0; r < regions.size(); r++)
+			if (regions[r].resident)
+				unload(regions[r]);
+	}
+
+private:
+	std::vector<StreamRegion> regions;
+	AssetLoader *loader;
+
+	void load(StreamRegion &region)
+	{
+		for (unsigned int p = 0; p < region.paths.size(); p++)
+			region.held.push_back(&loader->model(region.paths[p]));
+		region.resident = true;
+	}
+
+	void unload(StreamRegion &region)
+	{
+		for (unsigned int m = 0; m < region.held.size(); m++)
+			loader->release(*region.held[m]);
+		region.held.clear();
+		region.resident = false;
+	}
+};
+
+#endif
@@ -0,0 +1,367 @@
+#ifndef TAKES_H
+#define TAKES_H
+
+#include <keyframes.h>
+#include <mappedfile.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Keyframe takes on disk. A take is a sequence of frames, each one a time and a value per channel,
+// split in blocks of TAKE_BLOCK_FRAMES frames. Times are kept as floats so keys land exactly where
+// they were recorded; values are quantized to 16 bits against the range of their channel in the
+// block, so the error stays below half a step of that range.
+// The file is mapped and playback only touches the block around the sampled time, so the OS
+// reads a long take from disk as it plays and can drop the pages already played.
+//
+// Layout of a .take file, every section 4 byte aligned:
+//   TakeHeader
+//   blocks, each one:
+//     float min[channels]				value of quantized 0
+//     float scale[channels]				value step of one quantized unit
+//     float time[frames]
+//     unsigned short value[frames][channels]
+//   TakeBlock[blockCount]				at indexOffset, written once every block is
+const unsigned int TAKE_MAGIC = 0x454B4154;	// "TAKE"
+const unsigned int TAKE_VERSION = 1;
+const unsigned int TAKE_BLOCK_FRAMES = 256;
+
+struct TakeHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int channels;
+	unsigned int frames;
+	unsigned int blockFrames;
+	unsigned int blockCount;
+	unsigned int indexOffset;
+	float duration;				// Time of the last frame
+};
+
+// Entry of the block index
+struct TakeBlock
+{
+	float start;				// Time of the first frame
+	float end;					// Time of the last frame
+	unsigned int offset;		// From the start of the file
+	unsigned int frames;
+};
+
+// Writes a take frame by frame keeping only the current block in memory, so a long recording
+// never has to fit in memory. Frames must come in increasing time.
+class TakeWriter
+{
+public:
+	TakeWriter() : file(NULL), channelCount(0), frameCount(0), offset(0), ok(false)
+	{
+	}
+
+	~TakeWriter()
+	{
+		if (file != NULL)
+			close();
+	}
+
+	bool open(const std::string &path, unsigned int channels)
+	{
+		if (file != NULL)
+			close();
+		target = path;
+		temporary = temporaryPath(path);
+		file = std::fopen(temporary.c_str(), "wb");
+		if (file == NULL)
+			return false;
+		channelCount = channels;
+		frameCount = 0;
+		index.clear();
+		times.clear();
+		values.clear();
+		TakeHeader header;
+		std::memset(&header, 0, sizeof(header));
+		ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+		offset = sizeof(header);
+		return ok;
+	}
+
+	void frame(float time, const float *frameValues)
+	{
+		if (file == NULL)
+			return;
+		times.push_back(time);
+		values.insert(values.end(), frameValues, frameValues + channelCount);
+		frameCount++;
+		if (times.size() == TAKE_BLOCK_FRAMES)
+			flush();
+	}
+
+	// Writes the last block and the index and puts the file in place. Returns false when any
+	// write failed, the previous file at path is kept then.
+	bool close()
+	{
+		if (file == NULL)
+			return false;
+		flush();
+		TakeHeader header;
+		header.magic = TAKE_MAGIC;
+		header.version = TAKE_VERSION;
+		header.channels = channelCount;
+		header.frames = frameCount;
+		header.blockFrames = TAKE_BLOCK_FRAMES;
+		header.blockCount = (unsigned int)index.size();
+		header.indexOffset = offset;
+		header.duration = index.empty() ? 0.0f : index.back().end;
+		if (ok && !index.empty())
+			ok = std::fwrite(&index[0], sizeof(TakeBlock), index.size(), file) == index.size();
+		ok = ok && std::fseek(file, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(header), 1, file) == 1;
+		ok = std::fclose(file) == 0 && ok;
+		file = NULL;
+		return replaceFile(temporary, target, ok);
+	}
+
+private:
+	FILE *file;
+	std::string target;
+	std::string temporary;
+	unsigned int channelCount;
+	unsigned int frameCount;
+	unsigned int offset;
+	bool ok;
+	std::vector<TakeBlock> index;
+	std::vector<float> times;			// Frames of the current block
+	std::vector<float> values;
+
+	void flush()
+	{
+		unsigned int frames = (unsigned int)times.size();
+		if (frames == 0)
+			return;
+		std::vector<float> min(channelCount), scale(channelCount);
+		for (unsigned int c = 0; c < channelCount; c++)
+		{
+			float low = values[c], high = values[c];
+			for (unsigned int f = 1; f < frames; f++)
+			{
+				low = std::min(low, values[f * channelCount + c]);
+				high = std::max(high, values[f * channelCount + c]);
+			}
+			min[c] = low;
+			scale[c] = (high - low) / 65535.0f;
+		}
+		std::vector<unsigned short> quantized(values.size());
+		for (unsigned int f = 0; f < frames; f++)
+			for (unsigned int c = 0; c < channelCount; c++)
+			{
+				float q = scale[c] > 0.0f ? (values[f * channelCount + c] - min[c]) / scale[c] + 0.5f : 0.0f;
+				quantized[f * channelCount + c] = (unsigned short)std::min(q, 65535.0f);
+			}
+
+		TakeBlock block;
+		block.start = times.front();
+		block.end = times.back();
+		block.offset = offset;
+		block.frames = frames;
+		index.push_back(block);
+
+		unsigned int padding = (unsigned int)(quantized.size() * sizeof(unsigned short)) % 4;
+		const unsigned char zeros[4] = { 0, 0, 0, 0 };
+		if (ok && channelCount > 0)
+			ok = std::fwrite(&min[0], sizeof(float), channelCount, file) == channelCount &&
+				std::fwrite(&scale[0], sizeof(float), channelCount, file) == channelCount;
+		if (ok)
+			ok = std::fwrite(&times[0], sizeof(float), frames, file) == frames;
+		if (ok && !quantized.empty())
+			ok = std::fwrite(&quantized[0], sizeof(unsigned short), quantized.size(), file) == quantized.size();
+		if (ok && padding > 0)
+			ok = std::fwrite(zeros, 1, 4 - padding, file) == 4 - padding;
+		offset += (unsigned int)(2 * channelCount * sizeof(float) + frames * sizeof(float) + quantized.size() * sizeof(unsigned short));
+		if (padding > 0)
+			offset += 4 - padding;
+		times.clear();
+		values.clear();
+	}
+
+	TakeWriter(const TakeWriter&);
+	TakeWriter &operator=(const TakeWriter&);
+};
+
+// A take mapped from disk, played through a KeyframeAnimator clip with stream()
+class KeyframeTake : public KeyframeSource
+{
+public:
+	KeyframeTake() : header(NULL), index(NULL)
+	{
+	}
+
+	// Maps a take, returns false when it is missing, truncated or from another version
+	bool open(const std::string &path)
+	{
+		close();
+		if (!file.open(path.c_str()) || file.size() < sizeof(TakeHeader))
+			return fail();
+		header = (const TakeHeader*)file.data();
+		if (header->magic != TAKE_MAGIC || header->version != TAKE_VERSION || header->channels == 0 || header->blockCount == 0)
+			return fail();
+		if (header->indexOffset % 4 != 0 || (size_t)header->indexOffset + header->blockCount * sizeof(TakeBlock) > file.size())
+			return fail();
+		index = (const TakeBlock*)(file.data() + header->indexOffset);
+		for (unsigned int b = 0; b < header->blockCount; b++)
+			if (index[b].frames == 0 || index[b].offset % 4 != 0 || (size_t)index[b].offset + blockBytes(index[b].frames) > header->indexOffset)
+				return fail();
+		return true;
+	}
+
+	void close()
+	{
+		file.close();
+		header = NULL;
+		index = NULL;
+	}
+
+	bool isOpen() const
+	{
+		return header != NULL;
+	}
+
+	unsigned int channels() const
+	{
+		return header != NULL ? header->channels : 0;
+	}
+
+	unsigned int frames() const
+	{
+		return header != NULL ? header->frames : 0;
+	}
+
+	float duration() const
+	{
+		return header != NULL ? header->duration : 0.0f;
+	}
+
+	void locate(float time, float *from, float *to, float *factor) const
+	{
+		unsigned int channelCount = header->channels;
+		// Last block starting at or before time
+		unsigned int lo = 0, hi = header->blockCount;
+		while (hi - lo > 1)
+		{
+			unsigned int mid = (lo + hi) / 2;
+			if (index[mid].start <= time)
+				lo = mid;
+			else
+				hi = mid;
+		}
+		const TakeBlock &block = index[lo];
+		const float *times = blockTimes(block);
+		unsigned int k = (unsigned int)(std::upper_bound(times, times + block.frames, time) - times);
+
+		float t = 0.0f;
+		if (k == 0)
+		{
+			read(block, 0, from);
+			read(block, 0, to);
+		}
+		else if (k < block.frames)
+		{
+			read(block, k - 1, from);
+			read(block, k, to);
+			t = (time - times[k - 1]) / (times[k] - times[k - 1]);
+		}
+		else if (lo + 1 < header->blockCount)
+		{
+			// Between the last frame of this block and the first of the next one
+			const TakeBlock &next = index[lo + 1];
+			read(block, block.frames - 1, from);
+			read(next, 0, to);
+			float start = times[block.frames - 1];
+			t = next.start > start ? std::min((time - start) / (next.start - start), 1.0f) : 1.0f;
+		}
+		else
+		{
+			read(block, block.frames - 1, from);
+			read(block, block.frames - 1, to);
+		}
+		for (unsigned int c = 0; c < channelCount; c++)
+			factor[c] = t;
+	}
+
+	// Copies every frame into the clip's own keys, to edit a take
+	void load(KeyframeAnimator &animator, int clip) const
+	{
+		if (header == NULL)
+			return;
+		std::vector<float> frameValues(header->channels);
+		for (unsigned int b = 0; b < header->blockCount; b++)
+		{
+			const float *times = blockTimes(index[b]);
+			for (unsigned int f = 0; f < index[b].frames; f++)
+			{
+				read(index[b], f, &frameValues[0]);
+				for (unsigned int c = 0; c < header->channels && c < animator.channels(clip); c++)
+					animator.addKey(clip, c, times[f], frameValues[c]);
+			}
+		}
+	}
+
+private:
+	MappedFile file;
+	const TakeHeader *header;
+	const TakeBlock *index;
+
+	bool fail()
+	{
+		close();
+		return false;
+	}
+
+	size_t blockBytes(unsigned int frames) const
+	{
+		return 2 * header->channels * sizeof(float) + frames * sizeof(float) + frames * header->channels * sizeof(unsigned short);
+	}
+
+	const float *blockTimes(const TakeBlock &block) const
+	{
+		return (const float*)(file.data() + block.offset) + 2 * header->channels;
+	}
+
+	// Dequantizes frame f of a block
+	void read(const TakeBlock &block, unsigned int f, float *out) const
+	{
+		unsigned int channelCount = header->channels;
+		const float *min = (const float*)(file.data() + block.offset);
+		const float *scale = min + channelCount;
+		const unsigned short *quantized = (const unsigned short*)(scale + channelCount + block.frames) + f * channelCount;
+		for (unsigned int c = 0; c < channelCount; c++)
+			out[c] = min[c] + quantized[c] * scale[c];
+	}
+};
+
+// Writes the own keys of a clip as a take, a clip streaming from a source has nothing to write.
+// Channels keyed at different times are sampled at the union of their key times.
+inline bool writeTake(const std::string &path, const KeyframeAnimator &animator, int clip)
+{
+	if (animator.source(clip) != NULL)
+		return false;
+	std::vector<float> times;
+	for (unsigned int c = 0; c < animator.channels(clip); c++)
+		for (unsigned int k = 0; k < animator.keys(clip, c); k++)
+			times.push_back(animator.keyTime(clip, c, k));
+	std::sort(times.begin(), times.end());
+	times.erase(std::unique(times.begin(), times.end()), times.end());
+
+	TakeWriter writer;
+	if (!writer.open(path, animator.channels(clip)))
+		return false;
+	std::vector<float> frameValues(animator.channels(clip));
+	for (unsigned int f = 0; f < times.size(); f++)
+	{
+		for (unsigned int c = 0; c < frameValues.size(); c++)
+			frameValues[c] = animator.sample(clip, c, times[f]);
+		writer.frame(times[f], &frameValues[0]);
+	}
+	return writer.close();
+}
+
+#endif
@@ -0,0 +1,235 @@
+// Checks the kernels of transforms.h against the glm calls they replace, with no window or GL.
+// Build and run it with and without the SSE path from the root of the repository:
+//   g++ -std=c++17 -O2 -I. tests/transforms_test.cpp -o transforms_test && ./transforms_test
+//   g++ -std=c++17 -O2 -I. -DTRANSFORMS_NO_SSE tests/transforms_test.cpp -o transforms_test && ./transforms_test
+//   cl /std:c++17 /O2 /EHsc /I. tests\transforms_test.cpp (add /DTRANSFORMS_NO_SSE for the scalar path)
+// Returns 0 when every check passes.
+#include <transforms.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// Same measure as matrixDifference() of benchmark.h: the worst element difference, relative
+// to the element when it is larger than one
+static float difference(const glm::mat4 &a, const glm::mat4 &b)
+{
+	float worst = 0.0f;
+	for (int c = 0; c < 4; c++)
+		for (int r = 0; r < 4; r++)
+			worst = std::max(worst, std::abs(a[c][r] - b[c][r]) / std::max(1.0f, std::abs(a[c][r])));
+	return worst;
+}
+
+// Fixed sequence, so a failure repeats on every run and every compiler
+static unsigned int seed = 12345;
+
+static float randomFloat(float low, float high)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return low + (high - low) * (float)(seed >> 8) / 16777216.0f;
+}
+
+static glm::mat4 reference(const glm::vec3 &p, const glm::quat &q, const glm::vec3 &s)
+{
+	return glm::translate(glm::mat4(1.0f), p) * glm::mat4_cast(q) * glm::scale(glm::mat4(1.0f), s);
+}
+
+static int failures = 0;
+
+static void check(bool ok, const char *what, unsigned int count)
+{
+	if (!ok)
+	{
+		std::printf("FAIL %s (count %u)\n", what, count);
+		failures++;
+	}
+}
+
+struct Table
+{
+	std::vector<glm::vec3> position;
+	std::vector<glm::quat> rotation;
+	std::vector<glm::vec3> scale;
+	std::vector<int> parent;
+
+	// n entries with non-uniform scales, mirrored ones among them, and parents that always come
+	// before their children
+	explicit Table(unsigned int n) : position(n), rotation(n), scale(n), parent(n)
+	{
+		for (unsigned int i = 0; i < n; i++)
+		{
+			position[i] = glm::vec3(randomFloat(-50.0f, 50.0f), randomFloat(-50.0f, 50.0f), randomFloat(-50.0f, 50.0f));
+			glm::quat q(randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f));
+			rotation[i] = glm::dot(q, q) > 0.0001f ? glm::normalize(q) : glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+			scale[i] = glm::vec3(randomFloat(0.1f, 3.0f), randomFloat(0.1f, 3.0f), randomFloat(-3.0f, -0.1f));
+			parent[i] = i == 0 || randomFloat(0.0f, 1.0f) < 0.2f ? -1 : (int)(randomFloat(0.0f, 1.0f) * i);
+		}
+	}
+};
+
+// Index lists over n entries: in order, shuffled, a sparse subset in scene order and every entry
+// by depth, a permutation that still lists parents before their children
+static std::vector<unsigned int> inOrder(unsigned int count)
+{
+	std::vector<unsigned int> index(count);
+	for (unsigned int k = 0; k < count; k++)
+		index[k] = k;
+	return index;
+}
+
+static std::vector<unsigned int> shuffled(unsigned int n, unsigned int count)
+{
+	std::vector<unsigned int> index = inOrder(n);
+	for (unsigned int k = n - 1; k > 0; k--)
+		std::swap(index[k], index[(unsigned int)(randomFloat(0.0f, 1.0f) * (k + 1)) % (k + 1)]);
+	index.resize(count);
+	return index;
+}
+
+static std::vector<unsigned int> sparse(unsigned int n, unsigned int count)
+{
+	std::vector<unsigned int> index = shuffled(n, count);
+	std::sort(index.begin(), index.end());
+	return index;
+}
+
+static std::vector<unsigned int> byDepth(const Table &table)
+{
+	unsigned int n = (unsigned int)table.parent.size();
+	std::vector<unsigned int> depth(n), index;
+	for (unsigned int i = 0; i < n; i++)
+		depth[i] = table.parent[i] < 0 ? 0 : depth[table.parent[i]] + 1;
+	for (unsigned int d = 0; index.size() < n; d++)
+		for (unsigned int i = 0; i < n; i++)
+			if (depth[i] == d)
+				index.push_back(i);
+	return index;
+}
+
+static void testComposeSingle(const Table &table)
+{
+	float worst = 0.0f;
+	for (unsigned int i = 0; i < table.position.size(); i++)
+	{
+		glm::mat4 out;
+		composeTRS(table.position[i], table.rotation[i], table.scale[i], out);
+		worst = std::max(worst, difference(reference(table.position[i], table.rotation[i], table.scale[i]), out));
+	}
+	check(worst < 1.0e-4f, "composeTRS against glm", (unsigned int)table.position.size());
+}
+
+// The batched overload must write exactly the listed entries, like the single one does
+static void testComposeBatched(const Table &table, const std::vector<unsigned int> &index, const char *what)
+{
+	unsigned int n = (unsigned int)table.position.size();
+	const glm::mat4 untouched(7.0f);
+	std::vector<glm::mat4> out(n, untouched);
+	composeTRS(&table.position[0], &table.rotation[0], &table.scale[0], index.empty() ? NULL : &index[0], (unsigned int)index.size(), &out[0]);
+
+	std::vector<bool> listed(n, false);
+	float glmError = 0.0f, scalarError = 0.0f;
+	for (unsigned int k = 0; k < index.size(); k++)
+	{
+		unsigned int i = index[k];
+		listed[i] = true;
+		glm::mat4 single;
+		composeTRS(table.position[i], table.rotation[i], table.scale[i], single);
+		glmError = std::max(glmError, difference(reference(table.position[i], table.rotation[i], table.scale[i]), out[i]));
+		scalarError = std::max(scalarError, difference(single, out[i]));
+	}
+	bool others = true;
+	for (unsigned int i = 0; i < n; i++)
+		others = others && (listed[i] || out[i] == untouched);
+	check(glmError < 1.0e-4f, what, (unsigned int)index.size());
+	check(scalarError < 1.0e-5f, what, (unsigned int)index.size());
+	check(others, what, (unsigned int)index.size());
+}
+
+// World matrices of the whole table under root with glm products
+static std::vector<glm::mat4> referenceWorld(const Table &table, const glm::mat4 &root)
+{
+	unsigned int n = (unsigned int)table.position.size();
+	std::vector<glm::mat4> world(n);
+	for (unsigned int i = 0; i < n; i++)
+	{
+		glm::mat4 local = reference(table.position[i], table.rotation[i], table.scale[i]);
+		world[i] = (table.parent[i] < 0 ? root : world[table.parent[i]]) * local;
+	}
+	return world;
+}
+
+// Chains the listed entries while the rest keep the world matrices of the reference, like the
+// parts of a scene that did not change this frame
+static void testChain(const Table &table, const glm::mat4 &root, const std::vector<unsigned int> &index, const char *what)
+{
+	unsigned int n = (unsigned int)table.position.size();
+	std::vector<glm::mat4> expected = referenceWorld(table, root);
+	std::vector<glm::mat4> local(n);
+	std::vector<unsigned int> all = inOrder(n);
+	composeTRS(&table.position[0], &table.rotation[0], &table.scale[0], &all[0], n, &local[0]);
+
+	std::vector<glm::mat4> world = expected;
+	for (unsigned int k = 0; k < index.size(); k++)
+		world[index[k]] = glm::mat4(7.0f);
+	multiplyChain(&table.parent[0], root, &local[0], index.empty() ? NULL : &index[0], (unsigned int)index.size(), &world[0]);
+
+	float worst = 0.0f;
+	for (unsigned int i = 0; i < n; i++)
+		worst = std::max(worst, difference(expected[i], world[i]));
+	check(worst < 1.0e-4f, what, (unsigned int)index.size());
+
+	std::vector<glm::mat4> affine(n);
+	worst = 0.0f;
+	for (unsigned int k = 0; k < index.size(); k++)
+	{
+		unsigned int i = index[k];
+		multiplyAffine(table.parent[i] < 0 ? root : expected[table.parent[i]], local[i], affine[i]);
+		worst = std::max(worst, difference(expected[i], affine[i]));
+	}
+	check(worst < 1.0e-4f, "multiplyAffine against glm", (unsigned int)index.size());
+}
+
+int main()
+{
+#ifdef TRANSFORMS_SSE
+	std::printf("transforms.h with SSE\n");
+#else
+	std::printf("transforms.h without SSE\n");
+#endif
+	const unsigned int n = 263;
+	Table table(n);
+	testComposeSingle(table);
+
+	// Odd counts and counts just off a multiple of four leave a scalar tail after the SSE groups
+	const unsigned int counts[] = { 0, 1, 2, 3, 4, 5, 7, 9, 15, 17, 101, n };
+	for (unsigned int c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+	{
+		testComposeBatched(table, inOrder(counts[c]), "batched composeTRS, entries in order");
+		testComposeBatched(table, shuffled(n, counts[c]), "batched composeTRS, shuffled entries");
+		testComposeBatched(table, sparse(n, counts[c]), "batched composeTRS, sparse entries");
+	}
+
+	// A root with a perspective, so its last row is not 0 0 0 1, and a plain affine one
+	glm::mat4 camera = glm::lookAt(glm::vec3(30.0f, 40.0f, 60.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 1000.0f) * camera;
+	glm::mat4 isometric = glm::rotate(glm::mat4(1.0f), glm::radians(45.0f), glm::vec3(0.0f, 1.0f, 0.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(0.5f, 2.0f, 1.5f));
+	const glm::mat4 *roots[] = { &isometric, &projection };
+	for (int r = 0; r < 2; r++)
+		for (unsigned int c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+		{
+			testChain(table, *roots[r], inOrder(counts[c]), "multiplyChain, entries in order");
+			testChain(table, *roots[r], sparse(n, counts[c]), "multiplyChain, sparse entries");
+		}
+	for (int r = 0; r < 2; r++)
+		testChain(table, *roots[r], byDepth(table), "multiplyChain, entries by depth");
+
+	if (failures == 0)
+		std::printf("ok\n");
+	else
+		std::printf("%d checks failed\n", failures);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,525 @@
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include <glad/glad.h>
+
+#include <stb_image.h>
+
+#include <mappedfile.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// S3TC is an extension in GL 3.3, every desktop driver exposes it
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// Preprocessed textures: the first time an image is loaded it is decoded with stb_image, its mip
+// chain is built on the CPU, color images are compressed to BC1 (opaque) or BC3 (with alpha) and
+// the result is written next to it with .dds appended to its name. Later runs map that file and upload every level
+// as it is, with no decoding and no glGenerateMipmap. One channel images keep their GL_RED look
+// and are stored as uncompressed R8 levels. Images that already are .dds files are used directly.
+// The cache is rebuilt when the image is newer than it, when another version of this code wrote it
+// or when it was built from a file of another name.
+enum Texture_Format {
+	TEXTURE_R8,
+	TEXTURE_BC1,
+	TEXTURE_BC3
+};
+
+const unsigned int DDS_MAGIC = 0x20534444;	// "DDS "
+const unsigned int DDS_DXT1 = 0x31545844;	// "DXT1"
+const unsigned int DDS_DXT5 = 0x35545844;	// "DXT5"
+
+// Written in the reserved words of the header of the caches this code generates, along with the
+// length of the name of the image, which follows the last level
+const unsigned int TEXTURE_CACHE_TAG = 0x4E49424D;	// "MBIN", same tag as the mesh cache
+const unsigned int TEXTURE_CACHE_VERSION = 2;
+
+struct DdsPixelFormat
+{
+	unsigned int size;
+	unsigned int flags;
+	unsigned int fourCC;
+	unsigned int rgbBitCount;
+	unsigned int mask[4];
+};
+
+struct DdsHeader
+{
+	unsigned int size;
+	unsigned int flags;
+	unsigned int height;
+	unsigned int width;
+	unsigned int pitchOrLinearSize;
+	unsigned int depth;
+	unsigned int mipMapCount;
+	unsigned int reserved1[11];
+	DdsPixelFormat format;
+	unsigned int caps[4];
+	unsigned int reserved2;
+};
+
+struct TextureLevel
+{
+	unsigned int width;
+	unsigned int height;
+	const unsigned char *data;
+	unsigned int size;
+};
+
+// CPU side of a texture ready for upload. The levels either live in storage (fresh conversion)
+// or point into the mapped cache file, which stays open as long as this object does.
+struct TextureData
+{
+	std::string path;
+	Texture_Format format;
+	std::vector<TextureLevel> levels;
+	std::vector<unsigned char> storage;
+	MappedFile file;
+
+	TextureData() : format(TEXTURE_R8)
+	{
+	}
+};
+
+// Name of the cache of an image: the whole path with .dds appended, so images that only differ
+// in their extension get caches of their own and a .dds next to them is never overwritten
+inline std::string textureCachePath(const std::string &path)
+{
+	return path + ".dds";
+}
+
+inline bool isDdsPath(const std::string &path)
+{
+	size_t dot = path.find_last_of('.');
+	size_t slash = path.find_last_of("/\\");
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash) || path.size() - dot != 4)
+		return false;
+	return std::tolower((unsigned char)path[dot + 1]) == 'd' && std::tolower((unsigned char)path[dot + 2]) == 'd' && std::tolower((unsigned char)path[dot + 3]) == 's';
+}
+
+inline unsigned int levelSize(Texture_Format format, unsigned int width, unsigned int height)
+{
+	if (format == TEXTURE_R8)
+		return width * height;
+	return ((width + 3) / 4) * ((height + 3) / 4) * (format == TEXTURE_BC1 ? 8 : 16);
+}
+
+// Halves an image with a 2x2 box filter, the same filter glGenerateMipmap uses. A side of 1 stays
+// 1 and an odd side drops its last row or column. RGBA rows go through SSE2 two pixels at a time.
+inline void downsampleBox(const unsigned char *source, unsigned int width, unsigned int height, unsigned int channels, unsigned char *target)
+{
+	unsigned int halfWidth = width > 1 ? width / 2 : 1;
+	unsigned int halfHeight = height > 1 ? height / 2 : 1;
+	unsigned int stepX = width > 1 ? channels : 0;
+	unsigned int stepY = height > 1 ? width * channels : 0;
+	for (unsigned int y = 0; y < halfHeight; y++)
+	{
+		const unsigned char *row0 = source + (size_t)(height > 1 ? 2 * y : 0) * width * channels;
+		const unsigned char *row1 = row0 + stepY;
+		unsigned char *out = target + (size_t)y * halfWidth * channels;
+		unsigned int x = 0;
+#ifdef TEXTURE_SSE2
+		if (channels == 4 && stepX != 0)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i two = _mm_set1_epi16(2);
+			for (; x + 2 <= halfWidth; x += 2)
+			{
+				__m128i a = _mm_loadu_si128((const __m128i*)(row0 + x * 8));
+				__m128i b = _mm_loadu_si128((const __m128i*)(row1 + x * 8));
+				__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+				__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+				__m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+				sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+				_mm_storel_epi64((__m128i*)(out + x * 4), _mm_packus_epi16(sum, sum));
+			}
+		}
+#endif
+		for (; x < halfWidth; x++)
+		{
+			const unsigned char *p = row0 + (size_t)(width > 1 ? 2 * x : 0) * channels;
+			const unsigned char *q = row1 + (size_t)(width > 1 ? 2 * x : 0) * channels;
+			for (unsigned int c = 0; c < channels; c++)
+				out[x * channels + c] = (unsigned char)((p[c] + p[c + stepX] + q[c] + q[c + stepX] + 2) >> 2);
+		}
+	}
+}
+
+inline unsigned short packColor565(const int *color)
+{
+	return (unsigned short)(((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3));
+}
+
+inline void unpackColor565(unsigned short packed, int *color)
+{
+	int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+// Encodes the colors of a 4x4 RGBA block as BC1 in four color mode. The endpoints are the corners
+// of the bounding box along its diagonal that follows the colors, pulled in by 1/16 of the range.
+inline void encodeColorBlock(const unsigned char *block, unsigned char *out)
+{
+	int low[3] = { 255, 255, 255 }, high[3] = { 0, 0, 0 }, mean[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; i++)
+		for (int c = 0; c < 3; c++)
+		{
+			low[c] = std::min(low[c], (int)block[i * 4 + c]);
+			high[c] = std::max(high[c], (int)block[i * 4 + c]);
+			mean[c] += block[i * 4 + c];
+		}
+
+	// Green and blue run against red when they are negatively correlated with it
+	int covariance[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; i++)
+	{
+		int r = block[i * 4] * 16 - mean[0];
+		covariance[1] += r * (block[i * 4 + 1] * 16 - mean[1]);
+		covariance[2] += r * (block[i * 4 + 2] * 16 - mean[2]);
+	}
+	for (int c = 0; c < 3; c++)
+	{
+		int inset = (high[c] - low[c]) >> 4;
+		low[c] += inset;
+		high[c] -= inset;
+		if (covariance[c] < 0)
+			std::swap(low[c], high[c]);
+	}
+
+	unsigned short color0 = packColor565(high), color1 = packColor565(low);
+	unsigned int indices = 0;
+	if (color0 < color1)
+		std::swap(color0, color1);
+	if (color0 != color1)
+	{
+		int palette[4][3];
+		unpackColor565(color0, palette[0]);
+		unpackColor565(color1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0, bestError = 1 << 30;
+			for (int p = 0; p < 4; p++)
+			{
+				int dr = block[i * 4] - palette[p][0], dg = block[i * 4 + 1] - palette[p][1], db = block[i * 4 + 2] - palette[p][2];
+				int error = dr * dr + dg * dg + db * db;
+				if (error < bestError)
+				{
+					bestError = error;
+					best = p;
+				}
+			}
+			indices |= (unsigned int)best << (2 * i);
+		}
+	}
+
+	out[0] = (unsigned char)(color0 & 255); out[1] = (unsigned char)(color0 >> 8);
+	out[2] = (unsigned char)(color1 & 255); out[3] = (unsigned char)(color1 >> 8);
+	for (int b = 0; b < 4; b++)
+		out[4 + b] = (unsigned char)(indices >> (8 * b));
+}
+
+// Encodes the alpha of a 4x4 RGBA block as the eight value alpha block of BC3
+inline void encodeAlphaBlock(const unsigned char *block, unsigned char *out)
+{
+	int low = 255, high = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		low = std::min(low, (int)block[i * 4 + 3]);
+		high = std::max(high, (int)block[i * 4 + 3]);
+	}
+
+	unsigned long long indices = 0;
+	if (high != low)
+	{
+		int palette[8] = { high, low };
+		for (int p = 1; p < 7; p++)
+			palette[p + 1] = ((7 - p) * high + p * low) / 7;
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0, bestError = 256;
+			for (int p = 0; p < 8; p++)
+			{
+				int error = std::abs(block[i * 4 + 3] - palette[p]);
+				if (error < bestError)
+				{
+					bestError = error;
+					best = p;
+				}
+			}
+			indices |= (unsigned long long)best << (3 * i);
+		}
+	}
+
+	out[0] = (unsigned char)high;
+	out[1] = (unsigned char)low;
+	for (int b = 0; b < 6; b++)
+		out[2 + b] = (unsigned char)(indices >> (8 * b));
+}
+
+// Compresses an RGBA level block by block, repeating the last row and column at the edges
+inline void compressLevel(const unsigned char *pixels, unsigned int width, unsigned int height, Texture_Format format, unsigned char *out)
+{
+	unsigned char block[64];
+	for (unsigned int by = 0; by < height; by += 4)
+		for (unsigned int bx = 0; bx < width; bx += 4)
+		{
+			for (unsigned int y = 0; y < 4; y++)
+				for (unsigned int x = 0; x < 4; x++)
+				{
+					unsigned int sx = std::min(bx + x, width - 1), sy = std::min(by + y, height - 1);
+					std::memcpy(block + (y * 4 + x) * 4, pixels + ((size_t)sy * width + sx) * 4, 4);
+				}
+			if (format == TEXTURE_BC3)
+			{
+				encodeAlphaBlock(block, out);
+				out += 8;
+			}
+			encodeColorBlock(block, out);
+			out += 8;
+		}
+}
+
+// Decodes an image and builds its compressed mip chain into data.storage
+inline bool convertImage(const std::string &path, TextureData &data)
+{
+	int width, height, channels;
+	if (!stbi_info(path.c_str(), &width, &height, &channels))
+		return false;
+	unsigned int stored = channels == 1 ? 1 : 4;
+	unsigned char *pixels = stbi_load(path.c_str(), &width, &height, &channels, stored);
+	if (pixels == NULL)
+		return false;
+
+	data.format = TEXTURE_R8;
+	if (stored == 4)
+	{
+		data.format = TEXTURE_BC1;
+		for (size_t i = 3; i < (size_t)width * height * 4; i += 4)
+			if (pixels[i] != 255)
+			{
+				data.format = TEXTURE_BC3;
+				break;
+			}
+	}
+
+	// Offsets first, storage may move while it grows
+	std::vector<unsigned int> offsets;
+	std::vector<unsigned char> level(pixels, pixels + (size_t)width * height * stored), half;
+	stbi_image_free(pixels);
+	unsigned int w = (unsigned int)width, h = (unsigned int)height;
+	data.levels.clear();
+	data.storage.clear();
+	for (;;)
+	{
+		unsigned int size = levelSize(data.format, w, h);
+		offsets.push_back((unsigned int)data.storage.size());
+		data.storage.resize(data.storage.size() + size);
+		if (data.format == TEXTURE_R8)
+			std::memcpy(&data.storage[offsets.back()], &level[0], size);
+		else
+			compressLevel(&level[0], w, h, data.format, &data.storage[offsets.back()]);
+
+		TextureLevel info;
+		info.width = w;
+		info.height = h;
+		info.size = size;
+		info.data = NULL;
+		data.levels.push_back(info);
+		if (w == 1 && h == 1)
+			break;
+
+		half.resize((size_t)std::max(w / 2, 1u) * std::max(h / 2, 1u) * stored);
+		downsampleBox(&level[0], w, h, stored, &half[0]);
+		level.swap(half);
+		w = std::max(w / 2, 1u);
+		h = std::max(h / 2, 1u);
+	}
+	for (unsigned int l = 0; l < data.levels.size(); l++)
+		data.levels[l].data = &data.storage[offsets[l]];
+	return true;
+}
+
+inline bool writeTextureCache(const std::string &path, const std::string &source, const TextureData &data)
+{
+	DdsHeader header;
+	std::memset(&header, 0, sizeof(header));
+	header.size = sizeof(DdsHeader);
+	header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000;	// caps, height, width, pixel format, mip count
+	header.height = data.levels[0].height;
+	header.width = data.levels[0].width;
+	header.mipMapCount = (unsigned int)data.levels.size();
+	header.reserved1[0] = TEXTURE_CACHE_TAG;
+	header.reserved1[1] = TEXTURE_CACHE_VERSION;
+	header.reserved1[2] = (unsigned int)source.size();
+	header.format.size = sizeof(DdsPixelFormat);
+	if (data.format == TEXTURE_R8)
+	{
+		header.flags |= 0x8;	// pitch
+		header.pitchOrLinearSize = header.width;
+		header.format.flags = 0x20000;	// luminance
+		header.format.rgbBitCount = 8;
+		header.format.mask[0] = 0xFF;
+	}
+	else
+	{
+		header.flags |= 0x80000;	// linear size
+		header.pitchOrLinearSize = data.levels[0].size;
+		header.format.flags = 0x4;	// fourCC
+		header.format.fourCC = data.format == TEXTURE_BC1 ? DDS_DXT1 : DDS_DXT5;
+	}
+	header.caps[0] = 0x1000 | 0x8 | 0x400000;	// texture, complex, mipmap
+
+	std::string temporary = temporaryPath(path);
+	FILE *file = std::fopen(temporary.c_str(), "wb");
+	if (file == NULL)
+		return false;
+	bool ok = std::fwrite(&DDS_MAGIC, sizeof(DDS_MAGIC), 1, file) == 1;
+	ok = ok && std::fwrite(&header, sizeof(header), 1, file) == 1;
+	for (unsigned int l = 0; ok && l < data.levels.size(); l++)
+		ok = std::fwrite(data.levels[l].data, 1, data.levels[l].size, file) == data.levels[l].size;
+	ok = ok && std::fwrite(source.data(), 1, source.size(), file) == source.size();
+	ok = std::fclose(file) == 0 && ok;
+	return replaceFile(temporary, path, ok);
+}
+
+// Maps a .dds file with BC1, BC3 or 8 bit luminance levels. A cache written by this code must also
+// carry the current version and the name of the image it was built from, source names that image
+// and is empty when the file is an authored .dds.
+inline bool readTextureCache(const std::string &path, const std::string &source, TextureData &data)
+{
+	if (!data.file.open(path.c_str()))
+		return false;
+	const unsigned char *bytes = data.file.data();
+	size_t size = data.file.size();
+
+	unsigned int magic;
+	DdsHeader header;
+	if (size < sizeof(magic) + sizeof(header))
+	{
+		data.file.close();
+		return false;
+	}
+	std::memcpy(&magic, bytes, sizeof(magic));
+	std::memcpy(&header, bytes + sizeof(magic), sizeof(header));
+
+	bool valid = magic == DDS_MAGIC && header.size == sizeof(DdsHeader) && header.width > 0 && header.height > 0;
+	bool cached = !source.empty();
+	if (cached)
+		valid = valid && header.reserved1[0] == TEXTURE_CACHE_TAG && header.reserved1[1] == TEXTURE_CACHE_VERSION;
+	if (header.format.flags & 0x4)
+	{
+		valid = valid && (header.format.fourCC == DDS_DXT1 || header.format.fourCC == DDS_DXT5);
+		data.format = header.format.fourCC == DDS_DXT1 ? TEXTURE_BC1 : TEXTURE_BC3;
+	}
+	else
+	{
+		valid = valid && header.format.rgbBitCount == 8;
+		data.format = TEXTURE_R8;
+	}
+
+	data.levels.clear();
+	size_t offset = sizeof(magic) + sizeof(header);
+	unsigned int w = header.width, h = header.height;
+	unsigned int count = header.mipMapCount > 0 ? header.mipMapCount : 1;
+	for (unsigned int l = 0; valid && l < count; l++)
+	{
+		TextureLevel level;
+		level.width = w;
+		level.height = h;
+		level.size = levelSize(data.format, w, h);
+		level.data = bytes + offset;
+		offset += level.size;
+		valid = offset <= size;
+		data.levels.push_back(level);
+		w = std::max(w / 2, 1u);
+		h = std::max(h / 2, 1u);
+	}
+	if (valid && cached)
+		valid = size - offset == source.size() && std::memcmp(bytes + offset, source.data(), source.size()) == 0;
+	if (!valid)
+	{
+		data.levels.clear();
+		data.file.close();
+		return false;
+	}
+	return true;
+}
+
+// Fills data from the cache of path, converting the image and writing the cache first when the
+// cache is missing, older than the image or unreadable. Only touches the CPU, any thread can call it.
+inline bool loadTextureData(const std::string &path, TextureData &data)
+{
+	data.path = path;
+	if (isDdsPath(path))
+		return readTextureCache(path, std::string(), data);
+
+	std::string cache = textureCachePath(path);
+	std::string source = fileName(path);
+	if (fileTime(cache) >= fileTime(path) && readTextureCache(cache, source, data))
+		return true;
+
+	if (!convertImage(path, data))
+		return false;
+	if (!writeTextureCache(cache, source, data))
+		std::cout << "Failed to write texture cache: " << cache << std::endl;
+	return true;
+}
+
+// Fills a texture with every level of data, with the sampling TextureFromFile sets up
+inline void uploadTexture(unsigned int textureID, const TextureData &data)
+{
+	if (data.levels.empty())
+	{
+		std::cout << "Texture failed to load at path: " << data.path << std::endl;
+		return;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (unsigned int l = 0; l < data.levels.size(); l++)
+	{
+		const TextureLevel &level = data.levels[l];
+		if (data.format == TEXTURE_R8)
+			glTexImage2D(GL_TEXTURE_2D, l, GL_RED, level.width, level.height, 0, GL_RED, GL_UNSIGNED_BYTE, level.data);
+		else
+		{
+			GLenum format = data.format == TEXTURE_BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+			glCompressedTexImage2D(GL_TEXTURE_2D, l, format, level.width, level.height, 0, level.size, level.data);
+		}
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)data.levels.size() - 1);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running tasks in the order they were submitted
+class ThreadPool
+{
+public:
+	// 0 uses one thread per core, leaving one for the main thread
+	explicit ThreadPool(unsigned int count = 0) : stopping(false), busy(0)
+	{
+		if (count == 0)
+		{
+			unsigned int cores = std::thread::hardware_concurrency();
+			count = cores > 1 ? cores - 1 : 1;
+		}
+		for (unsigned int i = 0; i < count; i++)
+			workers.push_back(std::thread(&ThreadPool::run, this));
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (unsigned int i = 0; i < workers.size(); i++)
+			workers[i].join();
+	}
+
+	void submit(const std::function<void()> &task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			tasks.push_back(task);
+		}
+		wake.notify_one();
+	}
+
+	// Blocks until every submitted task has finished
+	void wait()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		idle.wait(lock, [this] { return tasks.empty() && busy == 0; });
+	}
+
+	unsigned int size() const
+	{
+		return (unsigned int)workers.size();
+	}
+
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()> > tasks;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable idle;
+	bool stopping;
+	unsigned int busy;
+
+	void run()
+	{
+		for (;;)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this] { return stopping || !tasks.empty(); });
+				if (tasks.empty())
+					return;
+				task = tasks.front();
+				tasks.pop_front();
+				busy++;
+			}
+			task();
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				busy--;
+			}
+			idle.notify_all();
+		}
+	}
+
+	ThreadPool(const ThreadPool&);
+	ThreadPool &operator=(const ThreadPool&);
+};
+
+// Work posted by any thread and run by the thread that owns the GL context
+class MainThreadQueue
+{
+public:
+	void post(const std::function<void()> &task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			tasks.push_back(task);
+		}
+		posted.notify_one();
+	}
+
+	// Blocks until at least one task is waiting
+	void wait()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		posted.wait(lock, [this] { return !tasks.empty(); });
+	}
+
+	// Runs the tasks posted so far, returns how many ran
+	unsigned int run()
+	{
+		std::vector<std::function<void()> > ready;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			ready.swap(tasks);
+		}
+		for (unsigned int i = 0; i < ready.size(); i++)
+			ready[i]();
+		return (unsigned int)ready.size();
+	}
+
+private:
+	std::vector<std::function<void()> > tasks;
+	std::mutex mutex;
+	std::condition_variable posted;
+};
+
+#endif
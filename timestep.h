@@ -0,0 +1,47 @@
+#ifndef TIMESTEP_H
+#define TIMESTEP_H
+
+// Runs a simulation at a fixed rate whatever the frame rate is. Every frame hands the real time
+// to advance(), which says how many whole steps fit in the time accumulated so far; what is left
+// over is the fraction of a step the frame lies past the last simulated state, used to blend it
+// with the one before.
+class FixedTimestep
+{
+public:
+	double step;			// Seconds per simulation step
+	unsigned int maxSteps;	// Steps run by one frame at most, the rest of a long stall is dropped
+
+	explicit FixedTimestep(double rate = 60.0, unsigned int maxStepsPerFrame = 8) : step(1.0 / rate), maxSteps(maxStepsPerFrame), accumulator(0.0), last(-1.0)
+	{
+	}
+
+	// Adds the time elapsed since the previous call (in seconds) and returns how many steps to run
+	unsigned int advance(double now)
+	{
+		if (last >= 0.0 && now > last)
+			accumulator += now - last;
+		last = now;
+
+		unsigned int steps = 0;
+		while (accumulator >= step && steps < maxSteps)
+		{
+			accumulator -= step;
+			steps++;
+		}
+		if (steps == maxSteps && accumulator >= step)
+			accumulator = 0.0;
+		return steps;
+	}
+
+	// Fraction of a step between the last simulated state and now, in [0, 1)
+	float alpha() const
+	{
+		return (float)(accumulator / step);
+	}
+
+private:
+	double accumulator;
+	double last;
+};
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef TRANSFORMS_H
+#define TRANSFORMS_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Define TRANSFORMS_NO_SSE to build the batched kernels with the scalar code on any target.
+// tests/transforms_test.cpp checks both builds against glm.
+#if !defined(TRANSFORMS_NO_SSE) && (defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#define TRANSFORMS_SSE 1
+#include <xmmintrin.h>
+#endif
+
+// Affine matrix Translate * Rotate * Scale from a position, a unit quaternion and a scale,
+// written column by column instead of multiplying the matrices of glm::translate, glm::mat4_cast
+// and glm::scale
+inline void composeTRS(const glm::vec3 &p, const glm::quat &q, const glm::vec3 &s, glm::mat4 &out)
+{
+	float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+	float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+	out[0] = glm::vec4((1.0f - 2.0f * (yy + zz)) * s.x, (2.0f * (xy + wz)) * s.x, (2.0f * (xz - wy)) * s.x, 0.0f);
+	out[1] = glm::vec4((2.0f * (xy - wz)) * s.y, (1.0f - 2.0f * (xx + zz)) * s.y, (2.0f * (yz + wx)) * s.y, 0.0f);
+	out[2] = glm::vec4((2.0f * (xz + wy)) * s.z, (2.0f * (yz - wx)) * s.z, (1.0f - 2.0f * (xx + yy)) * s.z, 0.0f);
+	out[3] = glm::vec4(p, 1.0f);
+}
+
+// out = a * b for an affine b (last row 0 0 0 1), skipping the products by that row. a may be any
+// matrix, such as a root carrying a projection.
+inline void multiplyAffine(const glm::mat4 &a, const glm::mat4 &b, glm::mat4 &out)
+{
+	glm::mat4 result;
+	for (int c = 0; c < 3; c++)
+		result[c] = a[0] * b[c].x + a[1] * b[c].y + a[2] * b[c].z;
+	result[3] = a[0] * b[3].x + a[1] * b[3].y + a[2] * b[3].z + a[3];
+	out = result;
+}
+
+// Builds out[index[k]] from the transform of entry index[k] for k in [0, count). Four entries are
+// built per SSE instruction: their quaternions are spread over one register per component, the
+// nine rotation terms computed side by side and the columns transposed back into the matrices.
+// Does the same operations in the same order as composeTRS(), so both give the same matrices.
+inline void composeTRS(const glm::vec3 *position, const glm::quat *rotation, const glm::vec3 *scale, const unsigned int *index, unsigned int count, glm::mat4 *out)
+{
+	unsigned int k = 0;
+#ifdef TRANSFORMS_SSE
+	const __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f), zero = _mm_setzero_ps();
+	for (; k + 4 <= count; k += 4)
+	{
+		unsigned int a = index[k], b = index[k + 1], c = index[k + 2], d = index[k + 3];
+		__m128 qx = _mm_set_ps(rotation[d].x, rotation[c].x, rotation[b].x, rotation[a].x);
+		__m128 qy = _mm_set_ps(rotation[d].y, rotation[c].y, rotation[b].y, rotation[a].y);
+		__m128 qz = _mm_set_ps(rotation[d].z, rotation[c].z, rotation[b].z, rotation[a].z);
+		__m128 qw = _mm_set_ps(rotation[d].w, rotation[c].w, rotation[b].w, rotation[a].w);
+		__m128 sx = _mm_set_ps(scale[d].x, scale[c].x, scale[b].x, scale[a].x);
+		__m128 sy = _mm_set_ps(scale[d].y, scale[c].y, scale[b].y, scale[a].y);
+		__m128 sz = _mm_set_ps(scale[d].z, scale[c].z, scale[b].z, scale[a].z);
+
+		__m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+		__m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+		__m128 wx = _mm_mul_ps(qw, qx), wy = _mm_mul_ps(qw, qy), wz = _mm_mul_ps(qw, qz);
+
+		// Element r of column c for the four entries, then one column of each entry per register
+		__m128 c0 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+		__m128 c1 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+		__m128 c2 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+		__m128 c3 = zero;
+		_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+		_mm_storeu_ps(&out[a][0][0], c0); _mm_storeu_ps(&out[b][0][0], c1);
+		_mm_storeu_ps(&out[c][0][0], c2); _mm_storeu_ps(&out[d][0][0], c3);
+
+		c0 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+		c1 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+		c2 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+		c3 = zero;
+		_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+		_mm_storeu_ps(&out[a][1][0], c0); _mm_storeu_ps(&out[b][1][0], c1);
+		_mm_storeu_ps(&out[c][1][0], c2); _mm_storeu_ps(&out[d][1][0], c3);
+
+		c0 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+		c1 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+		c2 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+		c3 = zero;
+		_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+		_mm_storeu_ps(&out[a][2][0], c0); _mm_storeu_ps(&out[b][2][0], c1);
+		_mm_storeu_ps(&out[c][2][0], c2); _mm_storeu_ps(&out[d][2][0], c3);
+
+		out[a][3] = glm::vec4(position[a], 1.0f); out[b][3] = glm::vec4(position[b], 1.0f);
+		out[c][3] = glm::vec4(position[c], 1.0f); out[d][3] = glm::vec4(position[d], 1.0f);
+	}
+#endif
+	for (; k < count; k++)
+		composeTRS(position[index[k]], rotation[index[k]], scale[index[k]], out[index[k]]);
+}
+
+// world[i] = (parent[i] < 0 ? root : world[parent[i]]) * local[i] for i = index[k], k in [0, count).
+// Parents must come before their children in index, as they do in a scene table, so a chain
+// resolves in one pass. Every product takes the four columns of the parent in registers and builds
+// each column of the result from three broadcast multiplies, in the order of multiplyAffine().
+inline void multiplyChain(const int *parent, const glm::mat4 &root, const glm::mat4 *local, const unsigned int *index, unsigned int count, glm::mat4 *world)
+{
+	for (unsigned int k = 0; k < count; k++)
+	{
+		unsigned int i = index[k];
+		const glm::mat4 &a = parent[i] < 0 ? root : world[parent[i]];
+		const glm::mat4 &b = local[i];
+#ifdef TRANSFORMS_SSE
+		__m128 a0 = _mm_loadu_ps(&a[0][0]), a1 = _mm_loadu_ps(&a[1][0]), a2 = _mm_loadu_ps(&a[2][0]), a3 = _mm_loadu_ps(&a[3][0]);
+		__m128 column[4];
+		for (int c = 0; c < 4; c++)
+			column[c] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(b[c].x)), _mm_mul_ps(a1, _mm_set1_ps(b[c].y))), _mm_mul_ps(a2, _mm_set1_ps(b[c].z)));
+		column[3] = _mm_add_ps(column[3], a3);
+		for (int c = 0; c < 4; c++)
+			_mm_storeu_ps(&world[i][c][0], column[c]);
+#else
+		multiplyAffine(a, b, world[i]);
+#endif
+	}
+}
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef UNIFORMS_H
+#define UNIFORMS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <shader_m.h>
+
+#include <cstring>
+#include <vector>
+
+// FNV-1a hash of a uniform name, evaluated by the compiler for constexpr keys
+constexpr unsigned int uniformHash(const char *name, unsigned int hash = 2166136261u)
+{
+	return *name ? uniformHash(name + 1, (hash ^ (unsigned char)*name) * 16777619u) : hash;
+}
+
+// A uniform name together with its precomputed hash. Declare keys as constexpr so the hot loop
+// never builds or hashes a string.
+struct UniformKey
+{
+	const char *name;
+	unsigned int hash;
+
+	constexpr UniformKey(const char *uniformName) : name(uniformName), hash(uniformHash(uniformName))
+	{
+	}
+};
+
+// Keys shared by the shaders of the project
+namespace Uniform
+{
+	constexpr UniformKey model("model");
+	constexpr UniformKey view("view");
+	constexpr UniformKey projection("projection");
+	constexpr UniformKey viewPos("viewPos");
+	constexpr UniformKey materialShininess("material_shininess");
+	constexpr UniformKey skybox("skybox");
+}
+
+// Companion of a Shader that resolves every uniform location once per program and keeps it in a
+// small open addressing table indexed by the key hash. Like the Shader setters, the program must
+// be in use when a value is set.
+class UniformCache
+{
+public:
+	Shader *shader;
+
+	UniformCache(Shader &s) : shader(&s), used(0)
+	{
+		slots.resize(64);
+	}
+
+	void use()
+	{
+		shader->use();
+	}
+
+	GLint location(const UniformKey &key)
+	{
+		unsigned int mask = (unsigned int)slots.size() - 1;
+		unsigned int i = key.hash & mask;
+		while (slots[i].name != NULL)
+		{
+			if (slots[i].hash == key.hash && (slots[i].name == key.name || std::strcmp(slots[i].name, key.name) == 0))
+				return slots[i].location;
+			i = (i + 1) & mask;
+		}
+
+		// First use of this name on the program
+		GLint loc = glGetUniformLocation(shader->ID, key.name);
+		slots[i].name = key.name;
+		slots[i].hash = key.hash;
+		slots[i].location = loc;
+		if (++used * 2 > slots.size())
+			grow();
+		return loc;
+	}
+
+	void setInt(const UniformKey &key, int value)
+	{
+		glUniform1i(location(key), value);
+	}
+
+	void setFloat(const UniformKey &key, float value)
+	{
+		glUniform1f(location(key), value);
+	}
+
+	void setVec3(const UniformKey &key, const glm::vec3 &value)
+	{
+		glUniform3fv(location(key), 1, &value[0]);
+	}
+
+	void setVec4(const UniformKey &key, const glm::vec4 &value)
+	{
+		glUniform4fv(location(key), 1, &value[0]);
+	}
+
+	void setMat4(const UniformKey &key, const glm::mat4 &value)
+	{
+		glUniformMatrix4fv(location(key), 1, GL_FALSE, glm::value_ptr(value));
+	}
+
+private:
+	struct Slot
+	{
+		const char *name;
+		unsigned int hash;
+		GLint location;
+
+		Slot() : name(NULL), hash(0), location(-1)
+		{
+		}
+	};
+
+	std::vector<Slot> slots;
+	unsigned int used;
+
+	void grow()
+	{
+		std::vector<Slot> old;
+		old.swap(slots);
+		slots.resize(old.size() * 2);
+		unsigned int mask = (unsigned int)slots.size() - 1;
+		for (unsigned int s = 0; s < old.size(); s++)
+		{
+			if (old[s].name == NULL)
+				continue;
+			unsigned int i = old[s].hash & mask;
+			while (slots[i].name != NULL)
+				i = (i + 1) & mask;
+			slots[i] = old[s];
+		}
+	}
+};
+
+#endif